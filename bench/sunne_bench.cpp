@@ -0,0 +1,395 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Microbenchmarks of the CPU side hot paths of the sunne
+   application. Needs no OpenGL context. Run from the install
+   directory so that the textures and models are found.
+
+   Usage: sunne_bench [filter]
+
+   Only the benchmarks which name contains the filter are run.
+ * ---------------------------------------------------------------- */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../src/renderer/sunne_atmosphere_model.h"
+#include "../src/renderer/sunne_pbr_model_importer.h"
+#include "../src/renderer/sunne_planet_quadtree.h"
+#include "../src/renderer/sunne_render_scale_controller.h"
+#include "../src/renderer/sunne_renderer_scene.h"
+#include "../src/renderer/sunne_sphere_mesh.h"
+#include "../src/renderer/sunne_texture_compression.h"
+
+/* ---------------------------------------------------------------- *
+   Allocation counters, updated by the global operator new.
+ * ---------------------------------------------------------------- */
+namespace
+{
+std::atomic<size_t> allocatedBytes(0);
+std::atomic<size_t> allocationCount(0);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void* operator new(size_t size)
+{
+    allocatedBytes  += size;
+    allocationCount += 1;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{ return operator new(size); }
+
+void operator delete(void* p) noexcept
+{ std::free(p); }
+
+void operator delete[](void* p) noexcept
+{ std::free(p); }
+
+void operator delete(void* p, size_t) noexcept
+{ std::free(p); }
+
+void operator delete[](void* p, size_t) noexcept
+{ std::free(p); }
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Prevents the compiler from removing the benchmarked work.
+ * ---------------------------------------------------------------- */
+volatile size_t sink = 0;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::string filter;
+
+/* ---------------------------------------------------------------- *
+   Runs the function once to warm up and then the given count of
+   iterations. Prints the time and the allocations per iteration.
+   Allocations of stb_image are not counted as it uses malloc.
+ * ---------------------------------------------------------------- */
+template<typename F>
+void run(const std::string& name, int iterations, F f)
+{
+    if (name.find(filter) == std::string::npos)
+        return;
+
+    f();
+
+    const size_t bytesStart = allocatedBytes;
+    const size_t countStart = allocationCount;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+        f();
+    const Clock::time_point end = Clock::now();
+
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const double bytes = double(allocatedBytes  - bytesStart);
+    const double count = double(allocationCount - countStart);
+
+    std::cout << std::left  << std::setw(48) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(16) << ns    / iterations << " ns/op"
+              << std::setw(14) << bytes / iterations << " B/op"
+              << std::setw(10) << count / iterations << " allocs/op"
+              << std::endl;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool exists(const std::string& path)
+{
+    if (std::ifstream(path).good())
+        return true;
+    std::cerr << "Skipping, file not found: " << path << std::endl;
+    return false;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchSphereMesh()
+{
+    run("sphere_mesh::sphere (32x32)", 1000, []()
+    {
+        sink = sink + sphere_mesh::sphere(1.0f, 32, 32).vertices.size();
+    });
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchPlanetQuadtree()
+{
+    PlanetQuadtree::Params params;
+    PlanetQuadtree quadtree(params);
+
+    const glm::mat4 projection =
+        glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.01f, 30000.0f);
+    const float screenScale = 0.5f * 1080.0f * projection[1][1];
+
+    // From the default camera distance to close to the surface.
+    const std::vector<float> distances = { 11000.0f, 7050.0f, 6371.5f };
+    for (float distance : distances)
+    {
+        const glm::vec3 cameraPos(0.0f, 0.0f, distance);
+        const glm::mat4 view = glm::lookAt(cameraPos,
+                                           glm::vec3(0.0f),
+                                           glm::vec3(0.0f, 1.0f, 0.0f));
+
+        run("PlanetQuadtree::select " + std::to_string(int(distance)) + " km",
+            1000, [&]()
+        {
+            sink = sink + quadtree.select(cameraPos,
+                                          projection * view,
+                                          screenScale).size();
+        });
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchModelImporter()
+{
+    const std::vector<std::string> paths =
+    {
+        "models/satellite/satellite.gltf",
+        "models/satellite/satellite.gltf.glb",
+        "models/satellite/satellite.obj",
+    };
+
+    for (const std::string& path : paths)
+    {
+        if (!exists(path))
+            continue;
+
+        run("ModelImporter::import " + path, 5, [&]()
+        {
+            sink = sink + ModelImporter().import(path).size();
+        });
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchTextureLoad()
+{
+    RendererScene scene;
+    const std::shared_ptr<RendererScene::Planet> earth = scene.planets.front();
+
+    struct Texture
+    {
+        std::string path;
+        int channels;
+    };
+
+    // Same channel counts as the planet renderer requests.
+    const std::vector<Texture> textures =
+    {
+        { earth->nightMap,    4 },
+        { earth->cloudMap,    4 },
+        { earth->albedoMap,   3 },
+        { earth->normalMap,   3 },
+        { earth->specularMap, 4 },
+    };
+
+    for (const Texture& texture : textures)
+    {
+        if (!exists(texture.path))
+            continue;
+
+        run("stbi_load " + texture.path, 3, [&]()
+        {
+            int w, h, c;
+            stbi_uc* pixels = stbi_load(texture.path.c_str(),
+                                        &w, &h, &c,
+                                        texture.channels);
+            sink = sink + size_t(w * h);
+            stbi_image_free(pixels);
+        });
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchTextureCompression()
+{
+    using texture_compression::Format;
+
+    // Synthetic RGBA image with gradients and noise.
+    const int size = 1024;
+    std::vector<unsigned char> pixels(size_t(size) * size * 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels[i] = static_cast<unsigned char>((i * 7 + (i >> 12) * 13) ^ (i >> 5));
+
+    const std::vector<std::pair<std::string, Format>> formats =
+    {
+        { "BC1", Format::BC1 },
+        { "BC3", Format::BC3 },
+        { "BC4", Format::BC4 },
+        { "BC5", Format::BC5 },
+        { "BC7", Format::BC7 },
+    };
+
+    for (const auto& format : formats)
+    {
+        std::vector<unsigned char> out(
+            texture_compression::compressedSize(format.second, size, size));
+
+        run("texture_compression::encode " + format.first + " (1024x1024)", 5, [&]()
+        {
+            texture_compression::encode(format.second, pixels.data(),
+                                        size, size, 4, out.data());
+            sink = sink + out[0];
+        });
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   The tables are baked once per model, a new model is created for
+   each bake.
+ * ---------------------------------------------------------------- */
+void benchAtmosphereModel()
+{
+    const RendererScene::Atmosphere atmosphere;
+
+    run("AtmosphereModel::opticalDepthTable", 5, [&]()
+    {
+        AtmosphereModel model(atmosphere);
+        sink = sink + model.opticalDepthTable().size();
+    });
+
+    run("AtmosphereModel::scatteringTable", 1, [&]()
+    {
+        AtmosphereModel model(atmosphere);
+        sink = sink + model.scatteringTable().size();
+    });
+
+    AtmosphereModel model(atmosphere);
+    model.scatteringTable();
+
+    RendererScene::Camera camera;
+    camera.position = glm::vec3(100.0f, 48.0f, 11000.0f);
+    camera.aspectRatio = 1920.0f / 817.0f;
+
+    AtmosphereModel::View view;
+    view.view           = camera.viewMatrix();
+    view.projection     = camera.projectionMatrix();
+    view.lightDirection = glm::vec3(1.0f, 1.0f, 1.0f);
+    view.lightIntensity = glm::vec3(10.0f, 10.0f, 10.0f);
+
+    std::vector<glm::vec3> sky, ground;
+    view.size = glm::ivec2(960, 408);
+    run("AtmosphereModel::render table (960x408)", 5, [&]()
+    {
+        model.render(view, AtmosphereModel::Method::Table, sky, ground);
+        sink = sink + sky.size();
+    });
+
+    view.size = glm::ivec2(240, 102);
+    run("AtmosphereModel::render reference (240x102)", 1, [&]()
+    {
+        model.render(view, AtmosphereModel::Method::Reference, sky, ground);
+        sink = sink + sky.size();
+    });
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void benchCamera()
+{
+    RendererScene::Camera camera;
+    camera.position = glm::vec3(100.0f, 48.0f, 11000.0f);
+    camera.aspectRatio = 1920.0f / 817.0f;
+
+    run("RendererScene::Camera::transformMatrix", 1000000, [&]()
+    {
+        camera.position.x += 0.001f;
+        sink = sink + size_t(camera.transformMatrix()[3][0] != 0.0f);
+    });
+
+    run("RendererScene::Camera::viewMatrix", 1000000, [&]()
+    {
+        camera.position.x += 0.001f;
+        sink = sink + size_t(camera.viewMatrix()[3][0] != 0.0f);
+    });
+
+    run("RendererScene::Camera::projectionMatrix", 1000000, [&]()
+    {
+        camera.lens.focalLength += 0.0001f;
+        sink = sink + size_t(camera.projectionMatrix()[0][0] != 0.0f);
+    });
+
+    run("RendererScene::Camera::screenBounds", 1000000, [&]()
+    {
+        camera.position.z += 0.001f;
+        sink = sink + size_t(camera.screenBounds(glm::vec3(0.0f), 6420.0f).x < 0.0f);
+    });
+}
+
+/* ---------------------------------------------------------------- *
+   The frame time is simulated to follow the pixel count of the
+   render scale.
+ * ---------------------------------------------------------------- */
+void benchRenderScaleController()
+{
+    RenderScaleController controller{ RenderScaleController::Params() };
+    const double fullScaleTime = 20.0; // ms
+
+    run("RenderScaleController::update", 1000000, [&]()
+    {
+        const float scale = controller.scale();
+        sink = sink + size_t(controller.update(fullScaleTime * scale * scale) < 1.0f);
+    });
+}
+
+} // anonymous namespace
+} // namespace sunne
+} // namespace kuu
+
+/* ---------------------------------------------------------------- *
+   Main entry
+ * ---------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    using namespace kuu::sunne;
+    if (argc > 1)
+        filter = argv[1];
+
+    try
+    {
+        benchSphereMesh();
+        benchPlanetQuadtree();
+        benchModelImporter();
+        benchTextureLoad();
+        benchTextureCompression();
+        benchAtmosphereModel();
+        benchCamera();
+        benchRenderScaleController();
+    }
+    catch(const std::runtime_error& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,31 +4,50 @@
  * ---------------------------------------------------------------- */
  
 #include "sunne_opengl_atmosphere_effect_render.h"
+#include <algorithm>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "sunne_opengl_atmosphere_tables.h"
+#include "sunne_opengl_frame_uniforms.h"
 #include "sunne_opengl_ndc_mesh.h"
-#include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
+#include "../sunne_atmosphere_model.h"
+#include "../sunne_render_scale_controller.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
 namespace sunne
 {
 
+namespace
+{
+
+// The scattering, history and history ground maps.
+const GLuint TextureUnit = opengl_state::texture_unit::Atmosphere;
+
+} // anonymous namespace
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 struct OpenGLAtmosphereEffectRender::Impl
 {
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(const glm::ivec2& size, OpenGLAtmosphereEffectRender* self)
-        : size(size)
+    Impl(const glm::ivec2& windowSize, int divisor,
+         std::shared_ptr<OpenGLShaderManager> shaders,
+         std::shared_ptr<OpenGLAtmosphereTables> tables,
+         OpenGLAtmosphereEffectRender* self)
+        : divisor(std::max(divisor, 1))
         , self(self)
+        , tables(tables)
     {
+        size = scaledSize(windowSize);
         createTexture();
-        createRenderbuffer();
         createFramebuffer();
-        createShader();
+        createShader(shaders);
         createMesh();
     }
 
@@ -37,95 +56,110 @@ struct OpenGLAtmosphereEffectRender::Impl
     ~Impl()
     {
         destroyMesh();
-        destroyShader();
         destroyFramebuffer();
-        destroyRenderbuffer();
         destroyTexture();
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createTexture()
+    glm::ivec2 scaledSize(const glm::ivec2& windowSize) const
     {
-        glGenTextures(1, &self->tex);
-        glBindTexture(GL_TEXTURE_2D, self->tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0,
-                     GL_RGB16F, size.x, size.y, 0,
-                     GL_RGB, GL_FLOAT, nullptr);
+        return glm::ivec2(std::max((windowSize.x + divisor - 1) / divisor, 1),
+                          std::max((windowSize.y + divisor - 1) / divisor, 1));
     }
 
     /* ------------------------------------------------------------ *
+       Creates the textures of both targets. The target that is not
+       rendered is the history of the temporal mode.
      * ------------------------------------------------------------ */
-    void destroyTexture()
-    {
-        glDeleteTextures(1, &self->tex);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createRenderbuffer()
+    void createTexture()
     {
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
-                              size.x, size.y);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        for (Target& target : targets)
+        for (GLuint* tex : { &target.tex, &target.groundTex })
+        {
+            glGenTextures(1, tex);
+            opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, *tex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0,
+                         GL_RGB16F, size.x, size.y, 0,
+                         GL_RGB, GL_FLOAT, nullptr);
+        }
+        historyValid = false;
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void destroyRenderbuffer()
+    void destroyTexture()
     {
-        glDeleteRenderbuffers(1, &rbo);
+        for (Target& target : targets)
+        {
+            opengl_state::deleteTextures(1, &target.tex);
+            opengl_state::deleteTextures(1, &target.groundTex);
+        }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void createFramebuffer()
     {
-        glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glFramebufferTexture2D(GL_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D,
-                               self->tex,
-                               0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                                  GL_DEPTH_ATTACHMENT,
-                                  GL_RENDERBUFFER,
-                                  rbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        for (Target& target : targets)
+        {
+            glGenFramebuffers(1, &target.fbo);
+            opengl_state::bindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                   GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D,
+                                   target.tex,
+                                   0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                   GL_COLOR_ATTACHMENT1,
+                                   GL_TEXTURE_2D,
+                                   target.groundTex,
+                                   0);
+            const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0,
+                                           GL_COLOR_ATTACHMENT1 };
+            glDrawBuffers(2, drawBuffers);
+        }
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void destroyFramebuffer()
     {
-        glDeleteFramebuffers(1, &fbo);
+        for (Target& target : targets)
+            opengl_state::deleteFramebuffers(1, &target.fbo);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createShader()
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
     {
-        pgm = opengl_shader_loader::load(
+        shaders->add(
                 "shaders/sunne_opengl_atmosphere_effect_render.vsh",
-                "shaders/sunne_opengl_atmosphere_effect_render.fsh");
-        uniformViewport             = glGetUniformLocation(pgm, "viewport");
-        uniformInverseView          = glGetUniformLocation(pgm, "inverseView");
-        uniformInverseTransposeView = glGetUniformLocation(pgm, "inverseTransposeView");
-        uniformInverseProjection    = glGetUniformLocation(pgm, "inverseProjection");
+                "shaders/sunne_opengl_atmosphere_effect_render.fsh",
+                [this](GLuint linked) { locateUniforms(linked); });
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void destroyShader()
+    void locateUniforms(GLuint linked)
     {
-        glDeleteProgram(pgm);
+        pgm = linked;
+        uniformViewport             = glGetUniformLocation(pgm, "viewport");
+        uniformTemporal             = glGetUniformLocation(pgm, "temporal");
+        uniformPhase                = glGetUniformLocation(pgm, "phase");
+        uniformPreviousViewProjection = glGetUniformLocation(pgm, "previousViewProjection");
+        uniformAtmosphere.locate(pgm);
+        OpenGLFrameUniforms::bind(pgm);
+        opengl_state::useProgram(pgm);
+        glUniform1i(glGetUniformLocation(pgm, "scatteringMap"),    TextureUnit);
+        glUniform1i(glGetUniformLocation(pgm, "historyMap"),       TextureUnit + 1);
+        glUniform1i(glGetUniformLocation(pgm, "historyGroundMap"), TextureUnit + 2);
+        historyValid = false;
     }
 
     /* ------------------------------------------------------------ *
@@ -146,59 +180,197 @@ struct OpenGLAtmosphereEffectRender::Impl
      * ------------------------------------------------------------ */
     void resize(const glm::ivec2& newSize)
     {
-        size = newSize;
+        size = scaledSize(newSize);
 
         destroyTexture();
-        destroyRenderbuffer();
         destroyFramebuffer();
 
         createTexture();
-        createRenderbuffer();
         createFramebuffer();
     }
 
     /* ------------------------------------------------------------ *
+       Renders the in-scattering with the CPU model and uploads it
+       into the target. The light is the same as in the fragment
+       shader.
      * ------------------------------------------------------------ */
-    void draw(std::shared_ptr<RendererScene> scene)
+    void drawCpu(const OpenGLFrameUniforms::Block& frame,
+                 const RendererScene::Atmosphere& atmosphere,
+                 const glm::ivec2& renderSize)
     {
-        glm::mat4 invProjection    = glm::inverse(scene->camera->projectionMatrix());
-        glm::mat4 invView          = glm::inverse(scene->camera->viewMatrix());
-        glm::mat3 invTransposeView = glm::inverseTranspose(glm::mat3(invView));
+        if (!cpuModel || !(cpuModel->atmosphere() == atmosphere))
+            cpuModel = std::make_shared<AtmosphereModel>(atmosphere);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        AtmosphereModel::View view;
+        view.view           = frame.view;
+        view.projection     = frame.projection;
+        view.size           = renderSize;
+        view.lightDirection = glm::vec3(frame.lightDirection);
+        view.lightIntensity = glm::vec3(frame.lightIntensity);
+        cpuModel->render(view, AtmosphereModel::Method::Table, cpuSky, cpuGround);
 
-        glViewport(0, 0, size.x, size.y);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        const Target& target = targets[current];
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, target.tex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderSize.x, renderSize.y,
+                        GL_RGB, GL_FLOAT, cpuSky.data());
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, target.groundTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderSize.x, renderSize.y,
+                        GL_RGB, GL_FLOAT, cpuGround.data());
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, 0);
 
-        glUseProgram(pgm);
-        glUniform2f(uniformViewport, float(size.x), float(size.y));
-        glUniformMatrix4fv(uniformInverseView,          1, GL_FALSE, glm::value_ptr(glm::mat4(invView)));
-        glUniformMatrix4fv(uniformInverseProjection,    1, GL_FALSE, glm::value_ptr(glm::mat4(invProjection)));
-        glUniformMatrix3fv(uniformInverseTransposeView, 1, GL_FALSE, glm::value_ptr(glm::mat3(invTransposeView)));
+        self->tex       = target.tex;
+        self->groundTex = target.groundTex;
+    }
 
-        ndcQuad->draw();
+    /* ------------------------------------------------------------ *
+       Converts the normalized device coordinate bounds into a pixel
+       rectangle (x, y, width, height) of the rendered area. The
+       rectangle is grown by a couple of texels as the shader takes
+       screen space derivatives and the compose filters the texels.
+     * ------------------------------------------------------------ */
+    glm::ivec4 scissorRect(const glm::vec4& bounds,
+                           const glm::ivec2& renderSize) const
+    {
+        const int padding = 2;
+        const glm::vec2 targetSize = glm::vec2(renderSize);
+        const glm::vec2 minPos = (glm::vec2(bounds.x, bounds.y) * 0.5f + 0.5f) * targetSize;
+        const glm::vec2 maxPos = (glm::vec2(bounds.z, bounds.w) * 0.5f + 0.5f) * targetSize;
+        const glm::ivec2 minPixel = glm::max(glm::ivec2(glm::floor(minPos)) - padding, glm::ivec2(0));
+        const glm::ivec2 maxPixel = glm::min(glm::ivec2(glm::ceil(maxPos))  + padding, renderSize);
+        return glm::ivec4(minPixel, maxPixel - minPixel);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void draw(std::shared_ptr<RendererScene> scene,
+              const OpenGLFrameUniforms::Block& frame)
+    {
+        const RendererScene::Atmosphere& atmosphere =
+            scene->planets.front()->atmosphere;
+        const glm::ivec2 renderSize =
+            RenderScaleController::scaledSize(size, self->renderScale);
+        self->texCoordScale = glm::vec2(renderSize) / glm::vec2(size);
+        if (self->cpu)
+        {
+            drawCpu(frame, atmosphere, renderSize);
+            return;
+        }
+
+        const bool ready = pgm && tables->update(atmosphere);
+
+        // The history is not valid after the tables have changed.
+        if (tables->version() != historyTables)
+        {
+            historyTables = tables->version();
+            historyValid = false;
+        }
+
+        // The history is not valid after the camera has jumped.
+        if (scene->camera->cuts != cameraCuts)
+        {
+            cameraCuts = scene->camera->cuts;
+            historyValid = false;
+        }
+        // The history texels do not match after the scale change.
+        if (renderSize != historySize)
+        {
+            historySize = renderSize;
+            historyValid = false;
+        }
+        const bool temporal = self->temporal && historyValid;
+
+        const Target& target  = targets[current];
+        const Target& history = targets[1 - current];
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, target.fbo);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        opengl_state::viewport(0, 0, renderSize.x, renderSize.y);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // The cleared target until the programs have been built.
+        if (!ready)
+        {
+            self->tex       = target.tex;
+            self->groundTex = target.groundTex;
+            return;
+        }
+
+        opengl_state::useProgram(pgm);
+        glUniform2f(uniformViewport, float(renderSize.x), float(renderSize.y));
+        glUniformMatrix4fv(uniformPreviousViewProjection, 1, GL_FALSE, glm::value_ptr(previousViewProjection));
+        glUniform1i(uniformTemporal, temporal ? 1 : 0);
+        glUniform1i(uniformPhase,    int(frameIndex % 4));
+        uniformAtmosphere.set(atmosphere);
+
+        opengl_state::bindTexture(TextureUnit,     GL_TEXTURE_3D, tables->scatteringTex());
+        opengl_state::bindTexture(TextureUnit + 1, GL_TEXTURE_2D, history.tex);
+        opengl_state::bindTexture(TextureUnit + 2, GL_TEXTURE_2D, history.groundTex);
+
+        // Only the rays that can hit the atmosphere are shaded, the
+        // rest of the target stays as cleared space.
+        const glm::ivec4 rect = scissorRect(scene->camera->screenBounds(
+                                    glm::vec3(0.0f), atmosphere.radius),
+                                    renderSize);
+        if (rect.z > 0 && rect.w > 0)
+        {
+            opengl_state::enable(GL_SCISSOR_TEST);
+            glScissor(rect.x, rect.y, rect.z, rect.w);
+            ndcQuad->draw();
+            opengl_state::disable(GL_SCISSOR_TEST);
+        }
+
+        self->tex       = target.tex;
+        self->groundTex = target.groundTex;
+        previousViewProjection = frame.viewProjection;
+        historyValid = true;
+        current = 1 - current;
+        frameIndex++;
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     glm::ivec2 size;
+    int divisor;
     OpenGLAtmosphereEffectRender* self;
-    GLuint rbo = 0;
-    GLuint fbo = 0;
     GLuint pgm = 0;
     GLint uniformViewport;
-    GLint uniformInverseView;
-    GLint uniformInverseTransposeView;
-    GLint uniformInverseProjection;
+    GLint uniformTemporal;
+    GLint uniformPhase;
+    GLint uniformPreviousViewProjection;
+    OpenGLAtmosphereUniforms uniformAtmosphere;
     std::shared_ptr<NdcQuadMesh> ndcQuad;
+    std::shared_ptr<OpenGLAtmosphereTables> tables;
+
+    // Render target and history, swapped after each frame.
+    struct Target
+    {
+        GLuint tex       = 0;
+        GLuint groundTex = 0;
+        GLuint fbo       = 0;
+    };
+    Target targets[2];
+    int current = 0;
+    unsigned frameIndex = 0;
+    int cameraCuts = 0;
+    bool historyValid = false;
+    glm::ivec2 historySize = glm::ivec2(0);
+    int historyTables = 0;
+    glm::mat4 previousViewProjection;
+
+    // CPU rendering
+    std::shared_ptr<AtmosphereModel> cpuModel;
+    std::vector<glm::vec3> cpuSky;
+    std::vector<glm::vec3> cpuGround;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLAtmosphereEffectRender::OpenGLAtmosphereEffectRender(const glm::ivec2& size)
-    : impl(std::make_shared<Impl>(size, this))
+OpenGLAtmosphereEffectRender::OpenGLAtmosphereEffectRender(
+        const glm::ivec2& size,
+        std::shared_ptr<OpenGLShaderManager> shaders,
+        std::shared_ptr<OpenGLAtmosphereTables> tables,
+        int divisor)
+    : impl(std::make_shared<Impl>(size, divisor, shaders, tables, this))
 {}
 
 /* ---------------------------------------------------------------- *
@@ -206,8 +378,12 @@ OpenGLAtmosphereEffectRender::OpenGLAtmosphereEffectRender(const glm::ivec2& siz
 void OpenGLAtmosphereEffectRender::resize(const glm::ivec2& size)
 { impl->resize(size); }
 
-void OpenGLAtmosphereEffectRender::draw(std::shared_ptr<RendererScene> scene)
-{ impl->draw(scene); }
+void OpenGLAtmosphereEffectRender::draw(std::shared_ptr<RendererScene> scene,
+                                        const OpenGLFrameUniforms::Block& frame)
+{
+    SUNNE_PROFILE_ZONE("OpenGLAtmosphereEffectRender::draw");
+    impl->draw(scene, frame);
+}
 
 } // namespace sunne
 } // namespace kuu
@@ -8,6 +8,7 @@
 #include <memory>
 #include <glad/glad.h>
 #include <glm/vec2.hpp>
+#include "sunne_opengl_frame_uniforms.h"
 #include "../sunne_renderer_scene.h"
 
 namespace kuu
@@ -15,16 +16,44 @@ namespace kuu
 namespace sunne
 { 
 
+class OpenGLAtmosphereTables;
+class OpenGLShaderManager;
+
 /* ---------------------------------------------------------------- *
+   Renders the atmosphere at the given size divided by the divisor.
+   The in-scattering of the rays that miss the ground is in the tex
+   and of the rays that hit the ground in the ground tex. Both have
+   a value in every texel so the compose can upsample them without
+   bleeding over the planet limb.
+
+   In the temporal mode a quarter of the texels is rendered each
+   frame, the rest is reprojected from the previous frame. The
+   history is dropped when the camera cuts.
+
+   In the CPU mode the in-scattering is rendered by AtmosphereModel
+   and uploaded into the textures.
+
+   Only the render scale fraction of the textures is rendered, the
+   texture coordinate scale maps the full view into the rendered
+   area. A change of the render scale drops the history.
  * ---------------------------------------------------------------- */
 class OpenGLAtmosphereEffectRender
 {
 public:
-    OpenGLAtmosphereEffectRender(const glm::ivec2& size);
+    OpenGLAtmosphereEffectRender(const glm::ivec2& size,
+                                 std::shared_ptr<OpenGLShaderManager> shaders,
+                                 std::shared_ptr<OpenGLAtmosphereTables> tables,
+                                 int divisor = 1);
     void resize(const glm::ivec2& size);
-    void draw(std::shared_ptr<RendererScene> scene);
+    void draw(std::shared_ptr<RendererScene> scene,
+              const OpenGLFrameUniforms::Block& frame);
 
-    GLuint tex = 0;
+    GLuint tex        = 0;
+    GLuint groundTex  = 0;
+    bool temporal     = false;
+    bool cpu          = false;
+    float renderScale = 1.0f;
+    glm::vec2 texCoordScale = glm::vec2(1.0f);
 
 private:
     struct Impl;
@@ -0,0 +1,76 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   In-scattering of the view rays from the single scattering table.
+
+   Include after sunne_opengl_atmosphere_model.glsl and
+   sunne_opengl_frame_uniforms.glsl.
+ * ---------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+uniform sampler3D scatteringMap;
+
+/* ---------------------------------------------------------------- *
+   Weight of the in-scattering when it is mixed with the surface,
+   the sky is mixed with the black space. Same as in the compose.
+ * ---------------------------------------------------------------- */
+const float inScatteringWeight = 0.6;
+
+/* ---------------------------------------------------------------- *
+   In-scattering from the radius to the top of atmosphere or to the
+   ground.
+ * ---------------------------------------------------------------- */
+vec3 inScattering(float r, float mu, float muS, float nu, bool ground)
+{
+    const float PI = 3.14159f;
+
+    vec4 s = scattering(scatteringMap, r, mu, muS, nu, ground);
+    vec3 rayleight = s.rgb;
+    vec3 mie       = vec3(s.a);
+
+    float vDotL = -nu;
+    float g = atmosphere.mieAnisotropy;
+    float rayleighPhase = 3.0f / (16.0f * PI) *  (1.0f + vDotL * vDotL);
+    float miePhase      = 3.0f / (8.0f  * PI) * ((1.0f - g * g) * (1.0f + vDotL * vDotL)) / ((2.0f + g * g) * pow(1.0f + g * g - 2.0f * g * vDotL, 1.5f));
+
+    vec3 lightIntensity = frame.lightIntensity.rgb;
+    vec3 rayleighInScattering = lightIntensity * atmosphere.rayleighScattering * rayleight * rayleighPhase;
+    vec3 mieInScattering      = lightIntensity * atmosphere.mieScattering      * mie       * miePhase;
+    return rayleighInScattering + mieInScattering;
+}
+
+/* ---------------------------------------------------------------- *
+   In-scattering along the world space view ray. A camera in space
+   is moved to the top of atmosphere, a ray that misses the
+   atmosphere has none. The view zenith is clamped to the given side
+   of the horizon so that a ray just past the limb gets the value of
+   the limb.
+ * ---------------------------------------------------------------- */
+vec3 viewInScattering(vec3 origo, vec3 direction, bool ground)
+{
+    float top = atmosphere.radius;
+    float r   = length(origo);
+    float rMu = dot(origo, direction);
+    if (r > top)
+    {
+        float discriminant = rMu * rMu - r * r + top * top;
+        if (rMu > 0.0 || discriminant < 0.0)
+            return vec3(0.0);
+
+        origo += direction * (-rMu - sqrt(discriminant));
+        r   = top;
+        rMu = dot(origo, direction);
+    }
+    r = max(r, atmosphere.planetRadius);
+
+    vec3 lightDirection = frame.lightDirection.xyz;
+    float mu  = clamp(rMu / r, -1.0, 1.0);
+    float muS = clamp(dot(origo, lightDirection) / r, -1.0, 1.0);
+    float nu  = clamp(dot(direction, lightDirection), -1.0, 1.0);
+
+    float ratio = atmosphere.planetRadius / r;
+    float muHorizon = -sqrt(max(1.0 - ratio * ratio, 0.0));
+    mu = ground ? min(mu, muHorizon) : max(mu, muHorizon);
+
+    return inScattering(r, mu, muS, nu, ground);
+}
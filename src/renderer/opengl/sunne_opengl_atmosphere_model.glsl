@@ -0,0 +1,257 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Atmosphere model shared by the atmosphere shaders.
+
+   The lookup tables use the parametrization of Bruneton's
+   precomputed atmospheric scattering. Radius r is the distance from
+   the planet center, mu is the cosine of the view zenith angle, muS
+   is the cosine of the sun zenith angle and nu is the cosine of the
+   angle between the view and sun directions.
+
+   See: https://ebruneton.github.io/precomputed_atmospheric_scattering/
+ * ---------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------- *
+   Sizes of the lookup tables, these must match with the sizes of
+   the textures in OpenGLAtmosphereEffectRender.
+ * ---------------------------------------------------------------- */
+const ivec2 opticalDepthSize   = ivec2(256, 64);
+const int scatteringRSize      = 32;
+const int scatteringMuSize     = 128;
+const int scatteringMuSSize    = 32;
+const int scatteringNuSize     = 8;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Atmosphere
+{
+    float planetRadius;
+    float radius;
+    float rayleighScaleHeight;
+    float mieScaleHeight;
+    vec3 rayleighScattering;
+    float mieScattering;
+    float mieAnisotropy;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+uniform Atmosphere atmosphere;
+
+/* ---------------------------------------------------------------- *
+   Sun zenith cosine below which the sun is under the horizon of
+   every point in the atmosphere.
+ * ---------------------------------------------------------------- */
+float muSMin()
+{
+    float ratio = atmosphere.planetRadius / atmosphere.radius;
+    return -sqrt(1.0 - ratio * ratio);
+}
+
+/* ---------------------------------------------------------------- *
+   Rayleigh (x) and Mie (y) particle density at the radius.
+ * ---------------------------------------------------------------- */
+vec2 particleDensity(float r)
+{
+    float h = max(r - atmosphere.planetRadius, 0.0);
+    return vec2(exp(-h / atmosphere.rayleighScaleHeight),
+                exp(-h / atmosphere.mieScaleHeight));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+float distanceToTop(float r, float mu)
+{
+    float top = atmosphere.radius;
+    float discriminant = r * r * (mu * mu - 1.0) + top * top;
+    return max(-r * mu + sqrt(max(discriminant, 0.0)), 0.0);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+float distanceToBottom(float r, float mu)
+{
+    float bottom = atmosphere.planetRadius;
+    float discriminant = r * r * (mu * mu - 1.0) + bottom * bottom;
+    return max(-r * mu - sqrt(max(discriminant, 0.0)), 0.0);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool rayIntersectsGround(float r, float mu)
+{
+    float bottom = atmosphere.planetRadius;
+    return mu < 0.0 && r * r * (mu * mu - 1.0) + bottom * bottom >= 0.0;
+}
+
+/* ---------------------------------------------------------------- *
+   Maps [0, 1] to the texel centers of the first and last texel.
+ * ---------------------------------------------------------------- */
+float texCoordFromUnitRange(float x, int size)
+{
+    return 0.5 / float(size) + x * (1.0 - 1.0 / float(size));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+float unitRangeFromTexCoord(float u, int size)
+{
+    return (u - 0.5 / float(size)) / (1.0 - 1.0 / float(size));
+}
+
+/* ---------------------------------------------------------------- *
+   Distance from the ground to the top of atmosphere along the
+   horizon.
+ * ---------------------------------------------------------------- */
+float horizonDistance()
+{
+    float top    = atmosphere.radius;
+    float bottom = atmosphere.planetRadius;
+    return sqrt(top * top - bottom * bottom);
+}
+
+/* ---------------------------------------------------------------- *
+   Optical depth table coordinates. The table covers the rays that
+   do not intersect the ground.
+ * ---------------------------------------------------------------- */
+vec2 opticalDepthUv(float r, float mu)
+{
+    float H = horizonDistance();
+    float bottom = atmosphere.planetRadius;
+    float rho = sqrt(max(r * r - bottom * bottom, 0.0));
+    float d = distanceToTop(r, mu);
+    float dMin = atmosphere.radius - r;
+    float dMax = rho + H;
+    float xMu = (d - dMin) / (dMax - dMin);
+    float xR  = rho / H;
+    return vec2(texCoordFromUnitRange(xMu, opticalDepthSize.x),
+                texCoordFromUnitRange(xR,  opticalDepthSize.y));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void opticalDepthRMu(vec2 uv, out float r, out float mu)
+{
+    float H = horizonDistance();
+    float bottom = atmosphere.planetRadius;
+    float xMu = unitRangeFromTexCoord(uv.x, opticalDepthSize.x);
+    float xR  = unitRangeFromTexCoord(uv.y, opticalDepthSize.y);
+    float rho = H * xR;
+    r = sqrt(rho * rho + bottom * bottom);
+    float dMin = atmosphere.radius - r;
+    float dMax = rho + H;
+    float d = dMin + xMu * (dMax - dMin);
+    mu = d == 0.0 ? 1.0 : clamp((H * H - rho * rho - d * d) / (2.0 * r * d), -1.0, 1.0);
+}
+
+/* ---------------------------------------------------------------- *
+   Rayleigh (x) and Mie (y) optical depth from the radius to the
+   top of atmosphere.
+ * ---------------------------------------------------------------- */
+vec2 opticalDepth(sampler2D opticalDepthMap, float r, float mu)
+{
+    return texture(opticalDepthMap, opticalDepthUv(r, mu)).rg;
+}
+
+/* ---------------------------------------------------------------- *
+   Scattering table coordinates. The lower half of the mu axis has
+   the rays that intersect the ground, the upper half the rays that
+   exit at the top of atmosphere.
+ * ---------------------------------------------------------------- */
+vec4 scatteringUvwz(float r, float mu, float muS, float nu, bool ground)
+{
+    float H = horizonDistance();
+    float top = atmosphere.radius;
+    float bottom = atmosphere.planetRadius;
+    float rho = sqrt(max(r * r - bottom * bottom, 0.0));
+    float uR = texCoordFromUnitRange(rho / H, scatteringRSize);
+
+    float rMu = r * mu;
+    float discriminant = rMu * rMu - r * r + bottom * bottom;
+    float uMu;
+    if (ground)
+    {
+        float d = -rMu - sqrt(max(discriminant, 0.0));
+        float dMin = r - bottom;
+        float dMax = rho;
+        float x = dMax == dMin ? 0.0 : (d - dMin) / (dMax - dMin);
+        uMu = 0.5 - 0.5 * texCoordFromUnitRange(x, scatteringMuSize / 2);
+    }
+    else
+    {
+        float d = -rMu + sqrt(max(discriminant + H * H, 0.0));
+        float dMin = top - r;
+        float dMax = rho + H;
+        uMu = 0.5 + 0.5 * texCoordFromUnitRange((d - dMin) / (dMax - dMin),
+                                                scatteringMuSize / 2);
+    }
+
+    float d = distanceToTop(bottom, muS);
+    float dMin = top - bottom;
+    float dMax = H;
+    float a = (d - dMin) / (dMax - dMin);
+    float A = (distanceToTop(bottom, muSMin()) - dMin) / (dMax - dMin);
+    float uMuS = texCoordFromUnitRange(max(1.0 - a / A, 0.0) / (1.0 + a),
+                                       scatteringMuSSize);
+    float uNu = (nu + 1.0) / 2.0;
+    return vec4(uNu, uMuS, uMu, uR);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void scatteringRMuMuSNu(vec4 uvwz,
+                        out float r, out float mu, out float muS,
+                        out float nu, out bool ground)
+{
+    float H = horizonDistance();
+    float top = atmosphere.radius;
+    float bottom = atmosphere.planetRadius;
+    float rho = H * unitRangeFromTexCoord(uvwz.w, scatteringRSize);
+    r = sqrt(rho * rho + bottom * bottom);
+
+    if (uvwz.z < 0.5)
+    {
+        float dMin = r - bottom;
+        float dMax = rho;
+        float d = dMin + (dMax - dMin) *
+            unitRangeFromTexCoord(1.0 - 2.0 * uvwz.z, scatteringMuSize / 2);
+        mu = d == 0.0 ? -1.0 : clamp(-(rho * rho + d * d) / (2.0 * r * d), -1.0, 1.0);
+        ground = true;
+    }
+    else
+    {
+        float dMin = top - r;
+        float dMax = rho + H;
+        float d = dMin + (dMax - dMin) *
+            unitRangeFromTexCoord(2.0 * uvwz.z - 1.0, scatteringMuSize / 2);
+        mu = d == 0.0 ? 1.0 : clamp((H * H - rho * rho - d * d) / (2.0 * r * d), -1.0, 1.0);
+        ground = false;
+    }
+
+    float xMuS = unitRangeFromTexCoord(uvwz.y, scatteringMuSSize);
+    float dMin = top - bottom;
+    float dMax = H;
+    float A = (distanceToTop(bottom, muSMin()) - dMin) / (dMax - dMin);
+    float a = (A - xMuS * A) / (1.0 + xMuS * A);
+    float d = dMin + min(a, A) * (dMax - dMin);
+    muS = d == 0.0 ? 1.0 : clamp((H * H - d * d) / (2.0 * bottom * d), -1.0, 1.0);
+    nu = clamp(uvwz.x * 2.0 - 1.0, -1.0, 1.0);
+}
+
+/* ---------------------------------------------------------------- *
+   Single scattering from the radius to the ground or to the top of
+   atmosphere. Rayleigh is in RGB and Mie in alpha. The nu axis is
+   packed into the width of the 3D texture with the muS axis, two
+   slices are interpolated manually.
+ * ---------------------------------------------------------------- */
+vec4 scattering(sampler3D scatteringMap,
+                float r, float mu, float muS, float nu, bool ground)
+{
+    vec4 uvwz = scatteringUvwz(r, mu, muS, nu, ground);
+    float texCoordX = uvwz.x * float(scatteringNuSize - 1);
+    float texX = floor(texCoordX);
+    float lerp = texCoordX - texX;
+    vec3 uvw0 = vec3((texX + uvwz.y) / float(scatteringNuSize), uvwz.z, uvwz.w);
+    vec3 uvw1 = vec3((texX + 1.0 + uvwz.y) / float(scatteringNuSize), uvwz.z, uvwz.w);
+    return mix(texture(scatteringMap, uvw0), texture(scatteringMap, uvw1), lerp);
+}
@@ -0,0 +1,255 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLAtmosphereTables class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_atmosphere_tables.h"
+#include <glm/gtc/type_ptr.hpp>
+#include "sunne_opengl_ndc_mesh.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
+#include "../../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Sizes of the lookup tables, these must match with the sizes in
+   sunne_opengl_atmosphere_model.glsl.
+ * ---------------------------------------------------------------- */
+namespace
+{
+
+const glm::ivec2 opticalDepthSize(256, 64);
+const int scatteringRSize   = 32;
+const int scatteringMuSize  = 128;
+const int scatteringMuSSize = 32;
+const int scatteringNuSize  = 8;
+
+// The optical depth map of the scattering bake.
+const GLuint TextureUnit = opengl_state::texture_unit::Atmosphere;
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLAtmosphereUniforms::locate(GLuint pgm)
+{
+    planetRadius        = glGetUniformLocation(pgm, "atmosphere.planetRadius");
+    radius              = glGetUniformLocation(pgm, "atmosphere.radius");
+    rayleighScaleHeight = glGetUniformLocation(pgm, "atmosphere.rayleighScaleHeight");
+    mieScaleHeight      = glGetUniformLocation(pgm, "atmosphere.mieScaleHeight");
+    rayleighScattering  = glGetUniformLocation(pgm, "atmosphere.rayleighScattering");
+    mieScattering       = glGetUniformLocation(pgm, "atmosphere.mieScattering");
+    mieAnisotropy       = glGetUniformLocation(pgm, "atmosphere.mieAnisotropy");
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLAtmosphereUniforms::set(const RendererScene::Atmosphere& a) const
+{
+    glUniform1f(planetRadius,        a.planetRadius);
+    glUniform1f(radius,              a.radius);
+    glUniform1f(rayleighScaleHeight, a.rayleighScaleHeight);
+    glUniform1f(mieScaleHeight,      a.mieScaleHeight);
+    glUniform3fv(rayleighScattering, 1, glm::value_ptr(a.rayleighScattering));
+    glUniform1f(mieScattering,       a.mieScattering);
+    glUniform1f(mieAnisotropy,       a.mieAnisotropy);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLAtmosphereTables::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(std::shared_ptr<OpenGLShaderManager> shaders)
+    {
+        createShader(shaders);
+        createLookupTables();
+        ndcQuad = std::make_shared<NdcQuadMesh>(true);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        destroyLookupTables();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
+    {
+        // The tables are baked again with the rebuilt programs.
+        shaders->add(
+                "shaders/sunne_opengl_atmosphere_effect_render.vsh",
+                "shaders/sunne_opengl_atmosphere_optical_depth.fsh",
+                [this](GLuint linked)
+        {
+            opticalDepthPgm = linked;
+            opticalDepthAtmosphere.locate(opticalDepthPgm);
+            baked = false;
+        });
+
+        shaders->add(
+                "shaders/sunne_opengl_atmosphere_effect_render.vsh",
+                "shaders/sunne_opengl_atmosphere_scattering.fsh",
+                [this](GLuint linked)
+        {
+            scatteringPgm = linked;
+            scatteringAtmosphere.locate(scatteringPgm);
+            uniformLayer = glGetUniformLocation(scatteringPgm, "layer");
+            opengl_state::useProgram(scatteringPgm);
+            glUniform1i(glGetUniformLocation(scatteringPgm, "opticalDepthMap"), TextureUnit);
+            baked = false;
+        });
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void createLookupTables()
+    {
+        glGenTextures(1, &opticalDepthTex);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, opticalDepthTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0,
+                     GL_RG32F, opticalDepthSize.x, opticalDepthSize.y, 0,
+                     GL_RG, GL_FLOAT, nullptr);
+
+        glGenTextures(1, &scatteringTex);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_3D, scatteringTex);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R,     GL_CLAMP_TO_EDGE);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F,
+                     scatteringNuSize * scatteringMuSSize,
+                     scatteringMuSize,
+                     scatteringRSize, 0,
+                     GL_RGBA, GL_FLOAT, nullptr);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_3D, 0);
+
+        glGenFramebuffers(1, &lookupFbo);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void destroyLookupTables()
+    {
+        opengl_state::deleteFramebuffers(1, &lookupFbo);
+        opengl_state::deleteTextures(1, &scatteringTex);
+        opengl_state::deleteTextures(1, &opticalDepthTex);
+    }
+
+    /* ------------------------------------------------------------ *
+       Bakes the lookup tables of the atmosphere. The scattering
+       table is rendered one layer at a time.
+     * ------------------------------------------------------------ */
+    void bakeLookupTables(const RendererScene::Atmosphere& atmosphere)
+    {
+        SUNNE_PROFILE_ZONE("OpenGLAtmosphereTables::bakeLookupTables");
+
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, lookupFbo);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D,
+                               opticalDepthTex,
+                               0);
+        opengl_state::viewport(0, 0, opticalDepthSize.x, opticalDepthSize.y);
+        opengl_state::useProgram(opticalDepthPgm);
+        opticalDepthAtmosphere.set(atmosphere);
+        ndcQuad->draw();
+
+        opengl_state::viewport(0, 0, scatteringNuSize * scatteringMuSSize, scatteringMuSize);
+        opengl_state::useProgram(scatteringPgm);
+        scatteringAtmosphere.set(atmosphere);
+        opengl_state::bindTexture(TextureUnit, GL_TEXTURE_2D, opticalDepthTex);
+        for (int layer = 0; layer < scatteringRSize; ++layer)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER,
+                                      GL_COLOR_ATTACHMENT0,
+                                      scatteringTex,
+                                      0,
+                                      layer);
+            glUniform1i(uniformLayer, layer);
+            ndcQuad->draw();
+        }
+
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        bakedAtmosphere = atmosphere;
+        baked = true;
+        version++;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    bool isReady() const
+    {
+        return opticalDepthPgm && scatteringPgm;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    bool update(const RendererScene::Atmosphere& atmosphere)
+    {
+        if (!isReady())
+            return false;
+        if (!baked || !(atmosphere == bakedAtmosphere))
+            bakeLookupTables(atmosphere);
+        return true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    std::shared_ptr<NdcQuadMesh> ndcQuad;
+    GLuint opticalDepthTex = 0;
+    GLuint scatteringTex   = 0;
+    GLuint lookupFbo       = 0;
+    GLuint opticalDepthPgm = 0;
+    GLuint scatteringPgm   = 0;
+    GLint uniformLayer;
+    OpenGLAtmosphereUniforms opticalDepthAtmosphere;
+    OpenGLAtmosphereUniforms scatteringAtmosphere;
+    RendererScene::Atmosphere bakedAtmosphere;
+    bool baked = false;
+    int version = 0;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLAtmosphereTables::OpenGLAtmosphereTables(
+        std::shared_ptr<OpenGLShaderManager> shaders)
+    : impl(std::make_shared<Impl>(shaders))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLAtmosphereTables::update(const RendererScene::Atmosphere& atmosphere)
+{ return impl->update(atmosphere); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLAtmosphereTables::isReady() const
+{ return impl->isReady(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint OpenGLAtmosphereTables::scatteringTex() const
+{ return impl->scatteringTex; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+int OpenGLAtmosphereTables::version() const
+{ return impl->version; }
+
+} // namespace sunne
+} // namespace kuu
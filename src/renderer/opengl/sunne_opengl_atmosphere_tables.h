@@ -0,0 +1,72 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLAtmosphereTables class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <glad/glad.h>
+#include "../sunne_renderer_scene.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+class OpenGLShaderManager;
+
+/* ---------------------------------------------------------------- *
+   Uniform locations of the atmosphere struct of the model, see
+   sunne_opengl_atmosphere_model.glsl.
+ * ---------------------------------------------------------------- */
+struct OpenGLAtmosphereUniforms
+{
+    void locate(GLuint pgm);
+    void set(const RendererScene::Atmosphere& a) const;
+
+    GLint planetRadius        = -1;
+    GLint radius              = -1;
+    GLint rayleighScaleHeight = -1;
+    GLint mieScaleHeight      = -1;
+    GLint rayleighScattering  = -1;
+    GLint mieScattering       = -1;
+    GLint mieAnisotropy       = -1;
+};
+
+/* ---------------------------------------------------------------- *
+   The precomputed lookup tables of the atmosphere model, the optical
+   depth table (r, mu) and the single scattering table
+   (nu * muS, mu, r). The tables are shared by the passes that read
+   the in-scattering.
+
+   The tables are baked again when the atmosphere changes or the
+   bake programs are rebuilt.
+ * ---------------------------------------------------------------- */
+class OpenGLAtmosphereTables
+{
+public:
+    OpenGLAtmosphereTables(std::shared_ptr<OpenGLShaderManager> shaders);
+
+    // Bakes the tables of the atmosphere if they are not up to
+    // date. Returns false until the bake programs have been built.
+    bool update(const RendererScene::Atmosphere& atmosphere);
+
+    // Returns true when the bake programs have been built.
+    bool isReady() const;
+
+    // Returns the single scattering table. It has been baked after
+    // update has returned true.
+    GLuint scatteringTex() const;
+
+    // Returns the count of the bakes, the results computed with the
+    // previous tables are stale when it changes.
+    int version() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
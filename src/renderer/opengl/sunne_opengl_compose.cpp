@@ -4,24 +4,32 @@
  * ---------------------------------------------------------------- */
  
 #include "sunne_opengl_compose.h"
-#include "sunne_opengl_shader_loader.h"
 #include "sunne_opengl_ndc_mesh.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
 namespace sunne
 {
 
+/* ---------------------------------------------------------------- *
+   First texture unit of the pass.
+ * ---------------------------------------------------------------- */
+const GLuint TextureUnit = opengl_state::texture_unit::Compose;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 struct OpenGLCompose::Impl
 {
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(OpenGLCompose* self)
+    Impl(std::shared_ptr<OpenGLShaderManager> shaders,
+         OpenGLCompose* self)
         : self(self)
     {
-        createShader();
+        createShader(shaders);
         createMesh();
     }
 
@@ -29,29 +37,29 @@ struct OpenGLCompose::Impl
      * ------------------------------------------------------------ */
     ~Impl()
     {
-        deleteShader();
         deleteMesh();
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createShader()
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
     {
-        pgm = opengl_shader_loader::load(
+        shaders->add(
             "shaders/sunne_opengl_compose.vsh",
-            "shaders/sunne_opengl_compose.fsh");
-        uniformShadingTexMap    = glGetUniformLocation(pgm, "shadingTexMap");
-        uniformAtmosphereTexMap = glGetUniformLocation(pgm, "atmosphereTexMap");
-        uniformStarTexMap       = glGetUniformLocation(pgm, "starTexMap");
-        uniformPlanetTexMap     = glGetUniformLocation(pgm, "planetTexMap");
-        uniformExposure         = glGetUniformLocation(pgm, "exposure");
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void deleteShader()
-    {
-        glDeleteProgram(pgm);
+            "shaders/sunne_opengl_compose.fsh",
+            [this](GLuint linked)
+        {
+            pgm = linked;
+            uniformExposure         = glGetUniformLocation(pgm, "exposure");
+            uniformTexCoordScale    = glGetUniformLocation(pgm, "texCoordScale");
+            uniformAtmosphereTexCoordScale = glGetUniformLocation(pgm, "atmosphereTexCoordScale");
+            opengl_state::useProgram(pgm);
+            glUniform1i(glGetUniformLocation(pgm, "shadingTexMap"),    TextureUnit);
+            glUniform1i(glGetUniformLocation(pgm, "atmosphereTexMap"), TextureUnit + 1);
+            glUniform1i(glGetUniformLocation(pgm, "starTexMap"),       TextureUnit + 2);
+            glUniform1i(glGetUniformLocation(pgm, "planetTexMap"),     TextureUnit + 3);
+            glUniform1i(glGetUniformLocation(pgm, "atmosphereGroundTexMap"), TextureUnit + 4);
+        });
     }
 
     /* ------------------------------------------------------------ *
@@ -72,24 +80,22 @@ struct OpenGLCompose::Impl
      * ------------------------------------------------------------ */
     void draw()
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, self->shadingTexMap);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, self->atmosphereTexMap);
+        if (pgm == 0)
+            return;
 
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, self->starTexMap);
+        opengl_state::bindTexture(TextureUnit, GL_TEXTURE_2D, self->shadingTexMap);
+        opengl_state::bindTexture(TextureUnit + 1, GL_TEXTURE_2D, self->atmosphereTexMap);
+        opengl_state::bindTexture(TextureUnit + 2, GL_TEXTURE_2D, self->starTexMap);
+        opengl_state::bindTexture(TextureUnit + 3, GL_TEXTURE_2D, self->planetTexMap);
+        opengl_state::bindTexture(TextureUnit + 4, GL_TEXTURE_2D, self->atmosphereGroundTexMap);
 
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, self->planetTexMap);
-
-        glUseProgram(pgm);
-        glUniform1i(uniformShadingTexMap,    0);
-        glUniform1i(uniformAtmosphereTexMap, 1);
-        glUniform1i(uniformStarTexMap,       2);
-        glUniform1i(uniformPlanetTexMap,     3);
+        opengl_state::useProgram(pgm);
         glUniform1f(uniformExposure,         self->exposure);
+        glUniform2f(uniformTexCoordScale,
+                    self->texCoordScale.x, self->texCoordScale.y);
+        glUniform2f(uniformAtmosphereTexCoordScale,
+                    self->atmosphereTexCoordScale.x,
+                    self->atmosphereTexCoordScale.y);
 
         ndcQuad->draw();
     }
@@ -97,25 +103,31 @@ struct OpenGLCompose::Impl
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     OpenGLCompose* self;
-    GLuint pgm;
-    GLint uniformShadingTexMap;
-    GLint uniformAtmosphereTexMap;
-    GLint uniformStarTexMap;
-    GLint uniformPlanetTexMap;
+    GLuint pgm = 0;
     GLint uniformExposure;
+    GLint uniformTexCoordScale;
+    GLint uniformAtmosphereTexCoordScale;
     std::shared_ptr<NdcQuadMesh> ndcQuad;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLCompose::OpenGLCompose()
-    : impl(std::make_shared<Impl>(this))
+OpenGLCompose::OpenGLCompose(std::shared_ptr<OpenGLShaderManager> shaders)
+    : impl(std::make_shared<Impl>(shaders, this))
 {}
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLCompose::isReady() const
+{ return impl->pgm != 0; }
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 void OpenGLCompose::draw()
-{ impl->draw(); }
+{
+    SUNNE_PROFILE_ZONE("OpenGLCompose::draw");
+    impl->draw();
+}
 
 } // namespace sunne
 } // namespace kuu
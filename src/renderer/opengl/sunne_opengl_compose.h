@@ -14,19 +14,31 @@ namespace kuu
 namespace sunne
 { 
 
+class OpenGLShaderManager;
+
 /* ---------------------------------------------------------------- *
+   Composes the pass textures into the window. The passes can be
+   rendered into a lower left fraction of their textures, the
+   texture coordinate scales map the window into these areas.
  * ---------------------------------------------------------------- */
 class OpenGLCompose
 {
 public:
-    OpenGLCompose();
+    OpenGLCompose(std::shared_ptr<OpenGLShaderManager> shaders);
     void draw();
 
+    // Returns true when the program has been built, the compose
+    // does not draw before that.
+    bool isReady() const;
+
     float exposure          = 0.8f;
     GLuint shadingTexMap    = 0;
     GLuint atmosphereTexMap = 0;
+    GLuint atmosphereGroundTexMap = 0;
     GLuint planetTexMap     = 0;
     GLuint starTexMap       = 0;
+    glm::vec2 texCoordScale = glm::vec2(1.0f);
+    glm::vec2 atmosphereTexCoordScale = glm::vec2(1.0f);
 
 private:
     struct Impl;
@@ -0,0 +1,32 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::opengl_extensions namespace.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_extensions.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace opengl_extensions
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool hasExtension(const std::string& extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const GLubyte* ext = glGetStringi(GL_EXTENSIONS, GLuint(i));
+        if (ext && extension == reinterpret_cast<const char*>(ext))
+            return true;
+    }
+    return false;
+}
+
+} // namespace opengl_extensions
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,25 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::opengl_extensions namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <string>
+#include <glad/glad.h>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace opengl_extensions
+{
+
+/* ---------------------------------------------------------------- *
+   Returns true if the current context has the extension.
+ * ---------------------------------------------------------------- */
+bool hasExtension(const std::string& extension);
+
+} // namespace opengl_extensions
+} // namespace sunne
+} // namespace kuu
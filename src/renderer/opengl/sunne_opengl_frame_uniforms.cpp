@@ -0,0 +1,101 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLFrameUniforms class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_frame_uniforms.h"
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include "../sunne_renderer_scene.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+// std140 packs the matrices as vec4 columns, the block has no padding.
+static_assert(sizeof(OpenGLFrameUniforms::Block) == 5 * 64 + 3 * 16,
+              "Frame uniform block does not match the std140 layout");
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLFrameUniforms::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl()
+    {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        glDeleteBuffers(1, &ubo);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void update(const RendererScene& scene)
+    {
+        const RendererScene::Camera& camera = *scene.camera;
+
+        block.view              = camera.viewMatrix();
+        block.projection        = camera.projectionMatrix();
+        block.viewProjection    = block.projection * block.view;
+        block.inverseView       = camera.transformMatrix();
+        block.inverseProjection = glm::inverse(block.projection);
+        block.cameraPosition    = block.inverseView[3];
+
+        if (!scene.stars.empty())
+        {
+            const RendererScene::Star& star = *scene.stars.front();
+            block.lightDirection = glm::vec4(glm::normalize(star.direction), 0.0f);
+            block.lightIntensity = glm::vec4(star.intensity, 0.0f);
+        }
+
+        // The whole buffer is replaced, the driver can orphan the
+        // storage of the previous frame.
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), &block, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, ubo);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    GLuint ubo = 0;
+    Block block = {};
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLFrameUniforms::OpenGLFrameUniforms()
+    : impl(std::make_shared<Impl>())
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLFrameUniforms::update(const RendererScene& scene)
+{ impl->update(scene); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const OpenGLFrameUniforms::Block& OpenGLFrameUniforms::block() const
+{ return impl->block; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLFrameUniforms::bind(GLuint pgm)
+{
+    const GLuint index = glGetUniformBlockIndex(pgm, "Frame");
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(pgm, index, BindingPoint);
+}
+
+} // namespace sunne
+} // namespace kuu
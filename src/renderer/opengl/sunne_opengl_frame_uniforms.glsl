@@ -0,0 +1,18 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Camera and light constants of the frame, see
+   kuu::sunne::OpenGLFrameUniforms. The layout must match with the
+   C++ block.
+ * ---------------------------------------------------------------- */
+
+layout(std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;       // camera transform
+    mat4 inverseProjection;
+    vec4 cameraPosition;    // world space
+    vec4 lightDirection;    // towards the star
+    vec4 lightIntensity;
+} frame;
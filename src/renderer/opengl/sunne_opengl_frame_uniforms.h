@@ -0,0 +1,66 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLFrameUniforms class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+class RendererScene;
+
+/* ---------------------------------------------------------------- *
+   Camera and light constants of a frame in a std140 uniform buffer.
+   The block is computed once per frame and bound into a fixed
+   binding point, the programs that include the frame uniforms
+   shader read it from there.
+
+   The layout of the block must match with the Frame block in
+   sunne_opengl_frame_uniforms.glsl.
+ * ---------------------------------------------------------------- */
+class OpenGLFrameUniforms
+{
+public:
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Block
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::mat4 inverseView;       // camera transform
+        glm::mat4 inverseProjection;
+        glm::vec4 cameraPosition;    // world space, w is 1
+        glm::vec4 lightDirection;    // towards the star, w is 0
+        glm::vec4 lightIntensity;
+    };
+
+    static const GLuint BindingPoint = 0;
+
+    OpenGLFrameUniforms();
+
+    // Computes the block from the camera and the first star of the
+    // scene, uploads it and binds the buffer.
+    void update(const RendererScene& scene);
+
+    // Returns the block of the latest update.
+    const Block& block() const;
+
+    // Binds the Frame block of the program into the binding point.
+    static void bind(GLuint pgm);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -6,13 +6,20 @@
 #include "sunne_opengl_loading.h"
 #include "sunne_opengl_ndc_mesh.h"
 #include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_state.h"
 #include "sunne_opengl_texture_loader.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
 namespace sunne
 {
 
+/* ---------------------------------------------------------------- *
+   First texture unit of the pass.
+ * ---------------------------------------------------------------- */
+const GLuint TextureUnit = opengl_state::texture_unit::Loading;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 struct OpenGLLoading::Impl
@@ -47,7 +54,7 @@ struct OpenGLLoading::Impl
      * ------------------------------------------------------------ */
     void destroyTexture()
     {
-        glDeleteTextures(1, &tex);
+        opengl_state::deleteTextures(1, &tex);
     }
 
     /* ------------------------------------------------------------ *
@@ -64,7 +71,7 @@ struct OpenGLLoading::Impl
      * ------------------------------------------------------------ */
     void destroyShader()
     {
-        glDeleteProgram(pgm);
+        opengl_state::deleteProgram(pgm);
     }
 
     /* ------------------------------------------------------------ *
@@ -85,18 +92,15 @@ struct OpenGLLoading::Impl
      * ------------------------------------------------------------ */
     void draw()
     {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glUseProgram(pgm);
-        glUniform1i(uniformTex, 0);
+        opengl_state::enable(GL_BLEND);
+        opengl_state::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        opengl_state::bindTexture(TextureUnit, GL_TEXTURE_2D, tex);
+        opengl_state::useProgram(pgm);
+        glUniform1i(uniformTex, TextureUnit);
 
         ndcQuad->draw();
 
-        glUseProgram(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glDisable(GL_BLEND);
+        opengl_state::disable(GL_BLEND);
     }
 
     /* ------------------------------------------------------------ *
@@ -117,7 +121,10 @@ OpenGLLoading::OpenGLLoading()
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 void OpenGLLoading::draw()
-{ impl->draw(); }
+{
+    SUNNE_PROFILE_ZONE("OpenGLLoading::draw");
+    impl->draw();
+}
 
 } // namespace sunne
 } // namespace kuu
@@ -8,6 +8,7 @@
 #include <vector>
 #include <glm/geometric.hpp>
 #include <glm/vec3.hpp>
+#include "sunne_opengl_state.h"
 
 namespace kuu
 {
@@ -50,7 +51,7 @@ NdcQuadMesh::NdcQuadMesh(bool flipY)
     };
     indexCount = GLuint(indexData.size());
 
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER,
                  vertexData.size() * sizeof(float),
@@ -72,23 +73,22 @@ NdcQuadMesh::NdcQuadMesh(bool flipY)
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
 
+    // The vertex array stays bound, unbinding the element buffer
+    // would detach it from the array.
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 NdcQuadMesh::~NdcQuadMesh()
 {
-    glDeleteVertexArrays(1, &vao);
+    opengl_state::deleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ibo);
 }
 
 void NdcQuadMesh::draw()
 {
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
 }
 
 /* ---------------------------------------------------------------- *
@@ -141,7 +141,7 @@ NdcCubeMesh::NdcCubeMesh(bool windingCCW)
 
     indexCount = GLuint(indexData.size());
 
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER,
                  vertexData.size() * sizeof(float),
@@ -157,23 +157,22 @@ NdcCubeMesh::NdcCubeMesh(bool windingCCW)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
                           3 * sizeof(float), BUFFER_OFFSET(0));
 
+    // The vertex array stays bound, unbinding the element buffer
+    // would detach it from the array.
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 NdcCubeMesh::~NdcCubeMesh()
 {
-    glDeleteVertexArrays(1, &vao);
+    opengl_state::deleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ibo);
 }
 
 void NdcCubeMesh::draw()
 {
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
 }
 
 /* ---------------------------------------------------------------- *
@@ -249,7 +248,7 @@ NdcSphereMesh::NdcSphereMesh(bool windingClockWise)
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ibo);
 
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER,
                  vertexData.size() * sizeof(float),
@@ -270,23 +269,22 @@ NdcSphereMesh::NdcSphereMesh(bool windingClockWise)
                           5 * sizeof(float),
                           BUFFER_OFFSET(3 * sizeof(float)));
 
+    // The vertex array stays bound, unbinding the element buffer
+    // would detach it from the array.
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 NdcSphereMesh::~NdcSphereMesh()
 {
-    glDeleteVertexArrays(1, &vao);
+    opengl_state::deleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ibo);
 }
 
 void NdcSphereMesh::draw()
 {
-    glBindVertexArray(vao);
+    opengl_state::bindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
 }
 
 } // namespace sunne
@@ -4,6 +4,8 @@
  * ---------------------------------------------------------------- */
 
 #include "sunne_opengl_planet.h"
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <math.h>
 #include <vector>
@@ -14,8 +16,13 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glad/glad.h>
-#include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_atmosphere_tables.h"
+#include "sunne_opengl_frame_uniforms.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
 #include "sunne_opengl_texture_loader.h"
+#include "../sunne_planet_quadtree.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
@@ -28,42 +35,31 @@ namespace sunne
 
 using namespace glm;
 
+/* ---------------------------------------------------------------- *
+   First texture unit of the pass.
+ * ---------------------------------------------------------------- */
+const GLuint TextureUnit = opengl_state::texture_unit::Planet;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 struct OpenGLPlanet::Impl
 {
     /* ------------------------------------------------------------ *
+       Index range of a patch grid.
      * ------------------------------------------------------------ */
-    Impl(OpenGLPlanet* self, const ivec2& size)
-        : self(self)
-        , size(size)
-    {
-        createShader();
-        createTexture();
-        createRenderbuffer();
-        createFramebuffer();
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createTexture()
+    struct Grid
     {
-        glGenTextures(1, &self->tex);
-        glBindTexture(GL_TEXTURE_2D, self->tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0,
-                     GL_RGB16F, size.x, size.y, 0,
-                     GL_RGB, GL_FLOAT, nullptr);
-    }
+        size_t offset = 0;
+        GLsizei count = 0;
+    };
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void destroyTexture()
+    Impl(std::shared_ptr<OpenGLShaderManager> shaders,
+         std::shared_ptr<OpenGLAtmosphereTables> tables)
+        : tables(tables)
     {
-        glDeleteTextures(1, &self->tex);
+        createShader(shaders);
     }
 
     /* ------------------------------------------------------------ *
@@ -71,191 +67,115 @@ struct OpenGLPlanet::Impl
     void createMeshVao()
     {
         glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
+        opengl_state::bindVertexArray(vao);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
         glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glEnableVertexAttribArray(3);
-        glEnableVertexAttribArray(4);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                              14 * sizeof(float),
+                              3 * sizeof(float),
                               BUFFER_OFFSET(0));
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
-                              14 * sizeof(float),
-                              BUFFER_OFFSET(3 * sizeof(float)));
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE,
-                              14 * sizeof(float),
-                              BUFFER_OFFSET(5 * sizeof(float)));
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
-                              14 * sizeof(float),
-                              BUFFER_OFFSET(8 * sizeof(float)));
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE,
-                              14 * sizeof(float),
-                              BUFFER_OFFSET(11 * sizeof(float)));
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        opengl_state::bindVertexArray(0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
     /* ------------------------------------------------------------ *
+       Appends a patch grid of the given count of quads per edge. A
+       vertex is (u, v, skirt) where u and v are in [0, 1] and skirt
+       is 1 for the vertices of the skirt that hangs below the edges
+       of the patch.
      * ------------------------------------------------------------ */
-    void createMeshBuffers()
+    Grid appendGrid(int quads,
+                    std::vector<float>& vertices,
+                    std::vector<unsigned>& indices)
     {
-        struct Vertex
+        Grid grid;
+        grid.offset = indices.size();
+
+        const unsigned base = unsigned(vertices.size() / 3);
+        const int n = quads + 1;
+        auto addVertex = [&](int x, int y, float skirt)
         {
-            vec3 pos;
-            vec2 texCoord;
-            vec3 normal;
-            vec3 tangent;
-            vec3 bitangent;
+            vertices.push_back(float(x) / float(quads));
+            vertices.push_back(float(y) / float(quads));
+            vertices.push_back(skirt);
         };
 
-        const int ringCount   = 128;
-        const int sectorCount = 128;
-        const float pi        = float(M_PI);
-        const float half_pi   = pi * 0.5f;
-        const float radius    = planet->radius;
-
-        std::vector<Vertex> vertexData;
-        std::vector<unsigned> indexData;
-        unsigned vertexCount = 0;
+        for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x)
+            addVertex(x, y, 0.0f);
 
-        auto addVertex = [&](const Vertex& v)
+        for (int y = 0; y < quads; ++y)
+        for (int x = 0; x < quads; ++x)
         {
-            vertexData.push_back(v);
-            indexData.push_back(vertexCount);
-            vertexCount++;
-        };
+            const unsigned a = base + unsigned((y + 0) * n + (x + 0));
+            const unsigned b = base + unsigned((y + 0) * n + (x + 1));
+            const unsigned c = base + unsigned((y + 1) * n + (x + 1));
+            const unsigned d = base + unsigned((y + 1) * n + (x + 0));
+            indices.insert(indices.end(), { a, b, c, c, d, a });
+        }
 
-        auto addTriangle = [&](
-                const Vertex& a,
-                const Vertex& b,
-                const Vertex& c)
+        // Skirts of the four edges, walk each edge and connect the
+        // edge vertex to its copy in the skirt.
+        const int edges[4][4] =
         {
-            addVertex(a);
-            addVertex(b);
-            addVertex(c);
+            // start x, start y, step x, step y
+            { 0,     0,     1,  0 },
+            { quads, 0,     0,  1 },
+            { quads, quads, -1, 0 },
+            { 0,     quads, 0, -1 },
         };
-
-        auto addQuad = [&](
-                const Vertex& a,
-                const Vertex& b,
-                const Vertex& c,
-                const Vertex& d)
+        for (const auto& e : edges)
         {
-            addTriangle(a, d, c);
-            addTriangle(c, b, a);
-        };
-
-        float ringStep   = 1.0f / float(ringCount   - 1);
-        float sectorStep = 1.0f / float(sectorCount - 1);
+            const unsigned skirtBase = unsigned(vertices.size() / 3);
+            for (int i = 0; i < n; ++i)
+                addVertex(e[0] + e[2] * i, e[1] + e[3] * i, 1.0f);
 
-        std::vector<Vertex> vertices2;
-        for(int r = 0; r < ringCount; ++r)
-            for( int s = 0; s < sectorCount; ++s)
+            for (int i = 0; i < quads; ++i)
             {
-                float y = sin(-half_pi + pi * r * ringStep);
-                float x = cos(2 * pi * s * sectorStep) * sin(pi * r * ringStep);
-                float z = sin(2 * pi * s * sectorStep) * sin(pi * r * ringStep);
-
-                glm::vec3 p = glm::vec3(x, y, z) * float(radius);
-                glm::vec2 tc = glm::vec2(s * sectorStep, r * ringStep);
-                glm::vec3 n = glm::normalize(p - glm::vec3(0.0f));
-                glm::vec3 t;
-                glm::vec3 bt;
-
-                vertices2.push_back(
-                { p, tc, n, t, bt });
-            }
-        //unsigned vertexCount = 0;
-
-        for(int r = 0; r < ringCount - 1; r++)
-        {
-            for(int s = 0; s < sectorCount - 1; s++)
-            {
-                size_t ia = size_t((r+0) * sectorCount + (s+0));
-                size_t ib = size_t((r+0) * sectorCount + (s+1));
-                size_t ic = size_t((r+1) * sectorCount + (s+1));
-                size_t id = size_t((r+1) * sectorCount + (s+0));
-
-                addQuad(vertices2[id],
-                        vertices2[ic],
-                        vertices2[ib],
-                        vertices2[ia]);
+                const int x0 = e[0] + e[2] * i, y0 = e[1] + e[3] * i;
+                const int x1 = x0 + e[2],       y1 = y0 + e[3];
+                const unsigned a = base + unsigned(y0 * n + x0);
+                const unsigned b = base + unsigned(y1 * n + x1);
+                const unsigned c = skirtBase + unsigned(i + 1);
+                const unsigned d = skirtBase + unsigned(i);
+                indices.insert(indices.end(), { a, d, c, c, b, a });
             }
         }
 
-        indexCount = GLsizei(indexData.size());
+        grid.count = GLsizei(indices.size() - grid.offset);
+        return grid;
+    }
 
-        for (size_t i = 0; i < indexData.size(); i += 3)
-        {
-            Vertex& v1 = vertexData[indexData[i + 0]];
-            Vertex& v2 = vertexData[indexData[i + 1]];
-            Vertex& v3 = vertexData[indexData[i + 2]];
-
-            glm::dvec3 edge1 = v2.pos - v1.pos;
-            glm::dvec3 edge2 = v3.pos - v1.pos;
-            glm::dvec2 dUV1 = v2.texCoord - v1.texCoord;
-            glm::dvec2 dUV2 = v3.texCoord - v1.texCoord;
-
-            double f = 1.0 / (dUV1.x * dUV2.y -
-                              dUV2.x * dUV1.y);
-
-            glm::dvec3 tangent;
-            tangent.x = f * (dUV2.y * edge1.x - dUV1.y * edge2.x);
-            tangent.y = f * (dUV2.y * edge1.y - dUV1.y * edge2.y);
-            tangent.z = f * (dUV2.y * edge1.z - dUV1.y * edge2.z);
-            tangent = glm::normalize(tangent);
-
-            glm::dvec3 bitangent;
-            bitangent.x = f * (-dUV2.x * edge1.x + dUV1.x * edge2.x);
-            bitangent.y = f * (-dUV2.x * edge1.y + dUV1.x * edge2.y);
-            bitangent.z = f * (-dUV2.x * edge1.z + dUV1.x * edge2.z);
-            bitangent = glm::normalize(bitangent);
-
-            v1.tangent = tangent;
-            v2.tangent = tangent;
-            v3.tangent = tangent;
-
-            v1.bitangent = bitangent;
-            v2.bitangent = bitangent;
-            v3.bitangent = bitangent;
-        }
+    /* ------------------------------------------------------------ *
+       Creates the full patch grid and the half grid that is used
+       for the quadrants of the partially split nodes.
+     * ------------------------------------------------------------ */
+    void createMeshBuffers()
+    {
+        const int gridSize = quadtree->params().gridSize;
 
-        std::vector<float> vertexData2;
-        for (const Vertex& v : vertexData)
-        {
-            vertexData2.push_back(v.pos.x);
-            vertexData2.push_back(v.pos.y);
-            vertexData2.push_back(v.pos.z);
-            vertexData2.push_back(v.texCoord.x);
-            vertexData2.push_back(v.texCoord.y);
-            vertexData2.push_back(v.normal.x);
-            vertexData2.push_back(v.normal.y);
-            vertexData2.push_back(v.normal.z);
-            vertexData2.push_back(v.tangent.x);
-            vertexData2.push_back(v.tangent.y);
-            vertexData2.push_back(v.tangent.z);
-            vertexData2.push_back(v.bitangent.x);
-            vertexData2.push_back(v.bitangent.y);
-            vertexData2.push_back(v.bitangent.z);
-        }
+        std::vector<float> vertices;
+        std::vector<unsigned> indices;
+        gridFull = appendGrid(gridSize,     vertices, indices);
+        gridHalf = appendGrid(gridSize / 2, vertices, indices);
 
         glGenBuffers(1, &vbo);
         glGenBuffers(1, &ibo);
 
+        // The element buffer binding belongs to the bound vertex
+        // array, a pass leaves its array bound after the draw.
+        opengl_state::bindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER,
-                     GLsizeiptr(vertexData2.size() * sizeof(float)),
-                     vertexData2.data(),
+                     GLsizeiptr(vertices.size() * sizeof(float)),
+                     vertices.data(),
                      GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     GLsizeiptr(indexData.size() * sizeof(unsigned int)),
-                     indexData.data(),
+                     GLsizeiptr(indices.size() * sizeof(unsigned int)),
+                     indices.data(),
                      GL_STATIC_DRAW);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -266,108 +186,101 @@ struct OpenGLPlanet::Impl
      * ------------------------------------------------------------ */
     void createTextures()
     {
-        texNight    = opengl_texture_loader::load(planet->nightMap,    4, true);
-        texCloud    = opengl_texture_loader::load(planet->cloudMap,    4, false);
-        texAlbedo   = opengl_texture_loader::load(planet->albedoMap,   3, true);
-        texNormal   = opengl_texture_loader::load(planet->normalMap,   3, false);
-        texSpecular = opengl_texture_loader::load(planet->specularMap, 4, false);
+        struct Job
+        {
+            GLuint* tex;
+            std::future<opengl_texture_loader::Image> image;
+        };
+
+        // The formats are checked here, the decode threads do not
+        // have a context.
+        auto decode = [](const std::string& path, int channels, bool sRgb,
+                         texture_compression::Format compression)
+        {
+            return std::async(std::launch::async,
+                              opengl_texture_loader::decode,
+                              path, channels, sRgb,
+                              opengl_texture_loader::supportedFormat(compression, sRgb));
+        };
+
+        // Decode the images concurrently.
+        std::vector<Job> jobs;
+        jobs.push_back({ &texNight,    decode(planet->nightMap,    4, true,  planet->nightCompression)    });
+        jobs.push_back({ &texCloud,    decode(planet->cloudMap,    4, false, planet->cloudCompression)    });
+        jobs.push_back({ &texAlbedo,   decode(planet->albedoMap,   3, true,  planet->albedoCompression)   });
+        jobs.push_back({ &texNormal,   decode(planet->normalMap,   3, false, planet->normalCompression)   });
+        jobs.push_back({ &texSpecular, decode(planet->specularMap, 4, false, planet->specularCompression) });
+
+        // Upload each image as soon as it has been decoded.
+        size_t uploaded = 0;
+        while (uploaded < jobs.size())
+        {
+            for (Job& job : jobs)
+            {
+                if (!job.image.valid())
+                    continue;
+                if (job.image.wait_for(std::chrono::milliseconds(1)) !=
+                    std::future_status::ready)
+                    continue;
+
+                *job.tex = opengl_texture_loader::upload(job.image.get());
+                uploaded++;
+            }
+        }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createShader()
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
     {
-        pgm = opengl_shader_loader::load(
+        shaders->add(
                 "shaders/sunne_opengl_planet.vsh",
-                "shaders/sunne_opengl_planet.fsh");
-        uniformProjectionMatrix       = glGetUniformLocation(pgm, "matrices.projection");
-        uniformViewMatrix             = glGetUniformLocation(pgm, "matrices.view");
-        uniformModelMatrix            = glGetUniformLocation(pgm, "matrices.model");
-        uniformNormalMatrix           = glGetUniformLocation(pgm, "matrices.normal");
-        uniformAlbedoMap              = glGetUniformLocation(pgm, "albedoMap");
-        uniformNormalMap              = glGetUniformLocation(pgm, "normalMap");
-        uniformSpecularMap            = glGetUniformLocation(pgm, "specularMap");
-        uniformCloudMap               = glGetUniformLocation(pgm, "cloudMap");
-        uniformNightMap               = glGetUniformLocation(pgm, "nightMap");
-        uniformCloudMapTexCoordOffset = glGetUniformLocation(pgm, "cloudMapTexCoordOffset");
+                tables ? "shaders/sunne_opengl_planet_fused.fsh"
+                       : "shaders/sunne_opengl_planet.fsh",
+                [this](GLuint linked) { locateUniforms(linked); });
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void destroyShader()
+    void locateUniforms(GLuint linked)
     {
-        glDeleteProgram(pgm);
+        pgm = linked;
+        uniformModelMatrix            = glGetUniformLocation(pgm, "matrices.model");
+        uniformNormalMatrix           = glGetUniformLocation(pgm, "matrices.normal");
+        uniformCloudMapTexCoordOffset = glGetUniformLocation(pgm, "cloudMapTexCoordOffset");
+        uniformNormalMapRG            = glGetUniformLocation(pgm, "normalMapRG");
+        uniformRadius                 = glGetUniformLocation(pgm, "radius");
+        uniformCameraPos              = glGetUniformLocation(pgm, "cameraPos");
+        uniformNodeFace               = glGetUniformLocation(pgm, "node.face");
+        uniformNodeOrigin             = glGetUniformLocation(pgm, "node.origin");
+        uniformNodeSize               = glGetUniformLocation(pgm, "node.size");
+        uniformNodeGridSize           = glGetUniformLocation(pgm, "node.gridSize");
+        uniformNodeMorph              = glGetUniformLocation(pgm, "node.morph");
+        OpenGLFrameUniforms::bind(pgm);
+
+        opengl_state::useProgram(pgm);
+        glUniform1i(glGetUniformLocation(pgm, "albedoMap"),   TextureUnit);
+        glUniform1i(glGetUniformLocation(pgm, "normalMap"),   TextureUnit + 1);
+        glUniform1i(glGetUniformLocation(pgm, "specularMap"), TextureUnit + 2);
+        glUniform1i(glGetUniformLocation(pgm, "cloudMap"),    TextureUnit + 3);
+        glUniform1i(glGetUniformLocation(pgm, "nightMap"),    TextureUnit + 4);
+
+        if (tables)
+        {
+            uniformExposure = glGetUniformLocation(pgm, "exposure");
+            uniformAtmosphere.locate(pgm);
+            glUniform1i(glGetUniformLocation(pgm, "scatteringMap"),
+                        opengl_state::texture_unit::Atmosphere);
+        }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     ~Impl()
     {
-        glDeleteVertexArrays(1, &vao);
+        opengl_state::deleteVertexArrays(1, &vao);
         glDeleteBuffers(1, &vbo);
         glDeleteBuffers(1, &ibo);
-        destroyShader();
-        destroyFramebuffer();
-        destroyRenderbuffer();
-        destroyTexture();
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createRenderbuffer()
-    {
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
-                              size.x, size.y);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyRenderbuffer()
-    {
-        glDeleteRenderbuffers(1, &rbo);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createFramebuffer()
-    {
-        glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glFramebufferTexture2D(GL_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D,
-                               self->tex,
-                               0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                                  GL_DEPTH_ATTACHMENT,
-                                  GL_RENDERBUFFER,
-                                  rbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyFramebuffer()
-    {
-        glDeleteFramebuffers(1, &fbo);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void resize(const glm::ivec2& newSize)
-    {
-        size = newSize;
-
-        destroyTexture();
-        destroyRenderbuffer();
-        destroyFramebuffer();
-
-        createTexture();
-        createRenderbuffer();
-        createFramebuffer();
     }
 
     /* ------------------------------------------------------------ *
@@ -379,115 +292,121 @@ struct OpenGLPlanet::Impl
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void draw(const mat4& viewMatrix, const mat4& projectionMatrix)
+    void draw(const OpenGLFrameUniforms::Block& frame,
+              const ivec2& renderSize,
+              float exposure)
     {
         if (vao == 0)
         {
+            PlanetQuadtree::Params params;
+            params.radius = planet->radius;
+            quadtree = std::make_shared<PlanetQuadtree>(params);
+
             createMeshBuffers();
             createMeshVao();
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-        glViewport(0, 0, size.x, size.y);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // The cleared target until the program has been built.
+        if (pgm == 0)
+            return;
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texAlbedo);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, texSpecular);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, texCloud);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, texNight);
+        opengl_state::bindTexture(TextureUnit, GL_TEXTURE_2D, texAlbedo);
+        opengl_state::bindTexture(TextureUnit + 1, GL_TEXTURE_2D, texNormal);
+        opengl_state::bindTexture(TextureUnit + 2, GL_TEXTURE_2D, texSpecular);
+        opengl_state::bindTexture(TextureUnit + 3, GL_TEXTURE_2D, texCloud);
+        opengl_state::bindTexture(TextureUnit + 4, GL_TEXTURE_2D, texNight);
+        if (tables)
+            opengl_state::bindTexture(opengl_state::texture_unit::Atmosphere,
+                                      GL_TEXTURE_3D, tables->scatteringTex());
 
         // Inclination rotation
         glm::quat inclination =
             glm::angleAxis(glm::radians(planet->inclination),
                                         glm::vec3(0.0f, 0.0f, 1.0f));
 
-        // Slow rotation
-        float amount = 0.0005f;
-        glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
-        if (planet->rotate)
-        {
-            // Fast rotation
-            amount = 0.05f;
-            axis = planet->rotateAxis;
-        }
-        rotation *= glm::angleAxis(glm::radians(amount), axis);
-
-        const glm::mat4 modelMatrix  = glm::mat4_cast(inclination * rotation);
+        const glm::mat4 modelMatrix  = glm::mat4_cast(inclination * planet->rotation);
         const glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(modelMatrix));
 
-        // Update texture coordinate offset of clouds
-        texOffset.x -= 0.00001f; // note: v-sync is enabled
-        if (texOffset.x > 1.0f)
-            texOffset.x = 1.0f - texOffset.x;
-        if (texOffset.x < 0.0f)
-            texOffset.x = 1.0f + texOffset.x;
+        // Select the patches in the planet local space.
+        const glm::mat4 modelView = frame.view * modelMatrix;
+        const glm::vec3 cameraPos = glm::vec3(glm::inverse(modelView) *
+                                              glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        const float screenScale = 0.5f * float(renderSize.y) * frame.projection[1][1];
+        const std::vector<PlanetQuadtree::Patch>& patches =
+            quadtree->select(cameraPos, frame.viewProjection * modelMatrix, screenScale);
 
-        glUseProgram(pgm);
+        opengl_state::useProgram(pgm);
         glUniformMatrix4fv(uniformModelMatrix, 1,
                            GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix4fv(uniformViewMatrix, 1,
-                           GL_FALSE, glm::value_ptr(viewMatrix));
-        glUniformMatrix4fv(uniformProjectionMatrix, 1,
-                           GL_FALSE, glm::value_ptr(projectionMatrix));
         glUniformMatrix3fv(uniformNormalMatrix, 1,
                            GL_FALSE, glm::value_ptr(normalMatrix));
-        glUniform1i(uniformAlbedoMap,   0);
-        glUniform1i(uniformNormalMap,   1);
-        glUniform1i(uniformSpecularMap, 2);
-        glUniform1i(uniformCloudMap,    3);
-        glUniform1i(uniformNightMap,    4);
         glUniform2fv(uniformCloudMapTexCoordOffset, 1,
-                     glm::value_ptr(texOffset));
-
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
+                     glm::value_ptr(planet->cloudMapOffset));
+        // BC5 normal map has only X and Y.
+        glUniform1i(uniformNormalMapRG,
+                    planet->normalCompression == texture_compression::Format::BC5);
+        glUniform1f(uniformRadius, planet->radius);
+        glUniform3fv(uniformCameraPos, 1, glm::value_ptr(cameraPos));
+        if (tables)
+        {
+            glUniform1f(uniformExposure, exposure);
+            uniformAtmosphere.set(planet->atmosphere);
+        }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        opengl_state::bindVertexArray(vao);
+        for (const PlanetQuadtree::Patch& patch : patches)
+        {
+            const glm::mat3 face = PlanetQuadtree::faceMatrix(patch.face);
+            glUniformMatrix3fv(uniformNodeFace, 1, GL_FALSE, glm::value_ptr(face));
+            glUniform2fv(uniformNodeOrigin, 1, glm::value_ptr(patch.origin));
+            glUniform1f(uniformNodeSize, patch.size);
+            glUniform1f(uniformNodeGridSize, float(patch.gridSize));
+            glUniform2fv(uniformNodeMorph, 1, glm::value_ptr(patch.morph));
+
+            const Grid& grid = patch.gridSize == quadtree->params().gridSize
+                             ? gridFull : gridHalf;
+            glDrawElements(GL_TRIANGLES, grid.count, GL_UNSIGNED_INT,
+                           BUFFER_OFFSET(grid.offset * sizeof(unsigned int)));
+        }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    OpenGLPlanet* self;
     std::shared_ptr<RendererScene::Planet> planet;
-    ivec2 size;
-    GLuint rbo = 0;
-    GLuint fbo = 0;
     GLuint vao = 0;
     GLuint vbo;
     GLuint ibo;
-    GLsizei indexCount;
+    Grid gridFull;
+    Grid gridHalf;
+    std::shared_ptr<PlanetQuadtree> quadtree;
     GLuint texAlbedo;
     GLuint texNormal;
     GLuint texSpecular;
     GLuint texCloud;
     GLuint texNight;
     GLuint pgm = 0;
-    GLint uniformProjectionMatrix;
-    GLint uniformViewMatrix;
     GLint uniformModelMatrix;
     GLint uniformNormalMatrix;
-    GLint uniformAlbedoMap;
-    GLint uniformNormalMap;
-    GLint uniformSpecularMap;
-    GLint uniformCloudMap;
-    GLint uniformNightMap;
     GLint uniformCloudMapTexCoordOffset;
-    glm::vec2 texOffset;
-    glm::quat rotation;
+    GLint uniformNormalMapRG;
+    GLint uniformRadius;
+    GLint uniformCameraPos;
+    GLint uniformNodeFace;
+    GLint uniformNodeOrigin;
+    GLint uniformNodeSize;
+    GLint uniformNodeGridSize;
+    GLint uniformNodeMorph;
+    // Fused forward, see the header.
+    std::shared_ptr<OpenGLAtmosphereTables> tables;
+    GLint uniformExposure;
+    OpenGLAtmosphereUniforms uniformAtmosphere;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLPlanet::OpenGLPlanet(const ivec2& size)
-    : impl(std::make_shared<Impl>(this, size))
+OpenGLPlanet::OpenGLPlanet(std::shared_ptr<OpenGLShaderManager> shaders,
+                           std::shared_ptr<OpenGLAtmosphereTables> tables)
+    : impl(std::make_shared<Impl>(shaders, tables))
 {}
 
 /* ---------------------------------------------------------------- *
@@ -504,13 +423,13 @@ void OpenGLPlanet::loadResources()
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-void OpenGLPlanet::resize(const ivec2& size)
-{ impl->resize(size); }
-
-/* ---------------------------------------------------------------- *
- * ---------------------------------------------------------------- */
-void OpenGLPlanet::draw(const mat4& view, const mat4& projection)
-{ impl->draw(view, projection); }
+void OpenGLPlanet::draw(const OpenGLFrameUniforms::Block& frame,
+                        const ivec2& renderSize,
+                        float exposure)
+{
+    SUNNE_PROFILE_ZONE("OpenGLPlanet::draw");
+    impl->draw(frame, renderSize, exposure);
+}
 
 } // namespace sunne
 } // namespace kuu
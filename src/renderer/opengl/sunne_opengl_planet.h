@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <glad/glad.h>
+#include "sunne_opengl_frame_uniforms.h"
 #include "../sunne_renderer_scene.h"
 
 namespace kuu
@@ -14,20 +15,28 @@ namespace kuu
 namespace sunne
 {
 
+class OpenGLAtmosphereTables;
+class OpenGLShaderManager;
+
 /* ---------------------------------------------------------------- *
+   With the atmosphere tables the planet is drawn for the fused
+   forward path, the in-scattering along the view ray is added to
+   the surface and the color is tone mapped.
  * ---------------------------------------------------------------- */
 class OpenGLPlanet
 {
 public:
-    OpenGLPlanet(const glm::ivec2& size);
+    OpenGLPlanet(std::shared_ptr<OpenGLShaderManager> shaders,
+                 std::shared_ptr<OpenGLAtmosphereTables> tables = nullptr);
 
     void setPlanet(std::shared_ptr<RendererScene::Planet> planet);
     void loadResources();
-    void resize(const glm::ivec2& size);
-    void draw(const glm::mat4& view,
-              const glm::mat4& projection);
-
-    GLuint tex = 0;
+    // Draws into the bound framebuffer. The render size is the
+    // size of the viewport, it selects the detail of the surface.
+    // The exposure is used only by the fused forward path.
+    void draw(const OpenGLFrameUniforms::Block& frame,
+              const glm::ivec2& renderSize,
+              float exposure = 0.0f);
 
 private:
     struct Impl;
@@ -0,0 +1,120 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Surface shading of kuu::OpenGLPlanet shared by the planet
+   fragment shaders.
+
+   Include after sunne_opengl_frame_uniforms.glsl.
+ * ---------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Matrices
+{
+    mat4 model;
+    mat3 normal;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const float PI = 3.14159265359;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+uniform Matrices matrices;
+uniform vec2 cloudMapTexCoordOffset;
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D specularMap;
+uniform sampler2D cloudMap;
+uniform sampler2D nightMap;
+uniform bool normalMapRG; // normal map has only X and Y
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+in struct VsOut
+{
+    vec3 localNormal;
+    vec3 worldNormal;
+    vec3 worldPos;
+    vec3 cameraPos;
+
+} vsOut;
+
+/* ---------------------------------------------------------------- *
+   Equirectangular texture coordinates of the local normal. The
+   longitude is taken from the one of the two parametrizations that
+   is continuous at the fragment so that the mip level selection
+   does not break at the seam (Tarini 2012).
+ * ---------------------------------------------------------------- */
+vec2 equirect(vec3 n)
+{
+    float s = atan(n.z, n.x) / (2.0 * PI);
+    float r = acos(clamp(-n.y, -1.0, 1.0)) / PI;
+
+    float s1 = fract(s);
+    float s2 = fract(s + 0.5) - 0.5;
+    s = fwidth(s1) < fwidth(s2) - 0.001 ? s1 : s2;
+
+    return vec2(1.0 - s, 1.0 - r);
+}
+
+/* ---------------------------------------------------------------- *
+   Tangent frame of the equirectangular mapping. Tangent follows
+   the longitude, it is undefined at the poles.
+ * ---------------------------------------------------------------- */
+mat3 tangentFrame(vec3 n)
+{
+    vec3 t = vec3(-n.z, 0.0, n.x);
+    if (dot(t, t) < 1e-12)
+        t = vec3(1.0, 0.0, 0.0);
+
+    vec3 wn = normalize(matrices.normal * n);
+    vec3 wt = normalize(matrices.normal * t);
+    wt = normalize(wt - dot(wt, wn) * wn);
+    return mat3(wt, cross(wn, wt), wn);
+}
+
+/* ---------------------------------------------------------------- *
+   Shaded color of the planet surface at the fragment.
+ * ---------------------------------------------------------------- */
+vec3 planetColor()
+{
+    vec3 localNormal = normalize(vsOut.localNormal);
+    vec2 tc = equirect(localNormal);
+    vec2 tcCloud = tc + cloudMapTexCoordOffset;
+    mat3 tbn = tangentFrame(localNormal);
+
+    vec3 n = normalize(vsOut.worldNormal);
+    n = texture(normalMap, tc).rgb;
+    if (normalMapRG)
+    {
+        vec2 xy = n.xy * 2.0 - 1.0;
+        n = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+    }
+    else
+        n = normalize(n * 2.0 - 1.0);
+    n = tbn * n;
+    n = normalize(n);
+
+    vec3 v = normalize(-vsOut.cameraPos);
+    vec3 l = frame.lightDirection.xyz;
+    vec3 r = reflect(-l, n);
+
+    float nDotL = max(dot(l, n), 0.0);
+    float vDotR = max(dot(v, r), 0.0);
+
+    vec3 albedo = vec3(0.0);
+    if (nDotL > 0)
+    {
+        albedo = texture(albedoMap, tc).rgb;
+        vec4 clouds = texture(cloudMap,  tcCloud);
+        albedo = mix(albedo, clouds.rgb, clouds.a) * nDotL;
+    }
+    else
+        albedo = texture(nightMap, tc).rgb;
+
+    vec3 diffuse  = albedo /** nDotL*/;
+    vec3 specular = vec3(texture(specularMap, tc).r) * pow(vDotR, 128.0);
+
+    return diffuse;
+}
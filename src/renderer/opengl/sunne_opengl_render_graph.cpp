@@ -0,0 +1,478 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLRenderGraph class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_render_graph.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include "sunne_opengl_state.h"
+#include "../../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool isDepthFormat(GLenum format)
+{
+    return format == GL_DEPTH_COMPONENT16 ||
+           format == GL_DEPTH_COMPONENT24 ||
+           format == GL_DEPTH_COMPONENT32F;
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLRenderGraph::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct TargetInfo
+    {
+        TargetDesc desc;
+        GLuint tex = 0;
+        bool imported = false;
+        bool cached   = false; // kept over the frames by its pass
+        int lastUse = -1; // index of the last live pass that uses it
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct PoolEntry
+    {
+        TargetDesc desc;
+        GLuint tex = 0;
+        bool free = true;
+        bool used = false; // in the current frame
+    };
+
+    /* ------------------------------------------------------------ *
+       The kept outputs of a cached pass.
+     * ------------------------------------------------------------ */
+    struct PassCache
+    {
+        uint64_t hash = 0;
+        int executedFrames = 0; // with the hash
+        std::vector<TargetDesc> descs;
+        std::vector<GLuint> textures;
+        bool used = false; // in the current frame
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        for (auto& fbo : fbos)
+            opengl_state::deleteFramebuffers(1, &fbo.second);
+        for (PoolEntry& e : pool)
+            opengl_state::deleteTextures(1, &e.tex);
+        for (auto& cache : caches)
+            for (GLuint& tex : cache.second.textures)
+                opengl_state::deleteTextures(1, &tex);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    GLuint createTexture(const TargetDesc& desc)
+    {
+        const bool depth = isDepthFormat(desc.format);
+
+        GLuint tex = 0;
+        glGenTextures(1, &tex);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0,
+                     GLint(desc.format), desc.size.x, desc.size.y, 0,
+                     depth ? GL_DEPTH_COMPONENT : GL_RGBA,
+                     GL_FLOAT, nullptr);
+        return tex;
+    }
+
+    /* ------------------------------------------------------------ *
+       Takes a free texture of the description from the pool or
+       creates a new one.
+     * ------------------------------------------------------------ */
+    GLuint acquire(const TargetDesc& desc)
+    {
+        for (PoolEntry& e : pool)
+        {
+            if (e.free &&
+                e.desc.size == desc.size &&
+                e.desc.format == desc.format)
+            {
+                e.free = false;
+                e.used = true;
+                return e.tex;
+            }
+        }
+
+        PoolEntry e;
+        e.desc = desc;
+        e.tex  = createTexture(desc);
+        e.free = false;
+        e.used = true;
+        pool.push_back(e);
+        return e.tex;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void release(GLuint tex)
+    {
+        for (PoolEntry& e : pool)
+            if (e.tex == tex)
+                e.free = true;
+    }
+
+    /* ------------------------------------------------------------ *
+       Deletes the texture and the framebuffers that have it
+       attached.
+     * ------------------------------------------------------------ */
+    void deleteTexture(GLuint& tex)
+    {
+        for (auto it = fbos.begin(); it != fbos.end();)
+        {
+            const std::vector<GLuint>& attachments = it->first;
+            if (std::find(attachments.begin(), attachments.end(), tex) !=
+                attachments.end())
+            {
+                opengl_state::deleteFramebuffers(1, &it->second);
+                it = fbos.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        opengl_state::deleteTextures(1, &tex);
+    }
+
+    /* ------------------------------------------------------------ *
+       Deletes the pool textures that were not used in the frame.
+     * ------------------------------------------------------------ */
+    void trimPool()
+    {
+        for (PoolEntry& e : pool)
+            if (!e.used)
+                deleteTexture(e.tex);
+
+        pool.erase(std::remove_if(pool.begin(), pool.end(),
+                                  [](const PoolEntry& e) { return !e.used; }),
+                   pool.end());
+        for (PoolEntry& e : pool)
+        {
+            e.free = true;
+            e.used = false;
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Gives the kept outputs of the cached pass their textures and
+       returns true if the pass can be skipped. The textures are
+       created again if the outputs have changed.
+     * ------------------------------------------------------------ */
+    bool useCache(const Pass& pass, const std::vector<bool>& needed)
+    {
+        std::vector<Target> kept;
+        std::vector<TargetDesc> descs;
+        for (Target t : pass.outputs)
+        {
+            const TargetInfo& target = targets[size_t(t)];
+            if (target.imported || !needed[size_t(t)])
+                continue;
+            kept.push_back(t);
+            descs.push_back(target.desc);
+        }
+
+        PassCache& cache = caches[pass.name];
+        cache.used = true;
+
+        bool same = cache.descs.size() == descs.size();
+        for (size_t i = 0; same && i < descs.size(); ++i)
+            same = cache.descs[i].size   == descs[i].size &&
+                   cache.descs[i].format == descs[i].format;
+        if (!same)
+        {
+            for (GLuint& tex : cache.textures)
+                deleteTexture(tex);
+            cache = PassCache();
+            cache.used  = true;
+            cache.descs = descs;
+            for (const TargetDesc& desc : descs)
+                cache.textures.push_back(createTexture(desc));
+        }
+
+        for (size_t i = 0; i < kept.size(); ++i)
+        {
+            TargetInfo& target = targets[size_t(kept[i])];
+            target.tex    = cache.textures[i];
+            target.cached = true;
+        }
+
+        if (same &&
+            cache.hash == pass.inputHash &&
+            cache.executedFrames > pass.settleFrames)
+        {
+            return true;
+        }
+
+        if (cache.hash == pass.inputHash)
+        {
+            cache.executedFrames++;
+        }
+        else
+        {
+            cache.hash = pass.inputHash;
+            cache.executedFrames = 1;
+        }
+        return false;
+    }
+
+    /* ------------------------------------------------------------ *
+       Deletes the caches of the passes that were not live in the
+       frame.
+     * ------------------------------------------------------------ */
+    void trimCaches()
+    {
+        for (auto it = caches.begin(); it != caches.end();)
+        {
+            if (it->second.used)
+            {
+                it->second.used = false;
+                ++it;
+                continue;
+            }
+            for (GLuint& tex : it->second.textures)
+                deleteTexture(tex);
+            it = caches.erase(it);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Returns the framebuffer of the pass outputs. The framebuffers
+       are cached by their attachments.
+     * ------------------------------------------------------------ */
+    GLuint framebuffer(const Pass& pass)
+    {
+        std::vector<GLuint> attachments;
+        for (Target t : pass.outputs)
+            attachments.push_back(targets[size_t(t)].tex);
+
+        auto it = fbos.find(attachments);
+        if (it != fbos.end())
+            return it->second;
+
+        GLuint fbo = 0;
+        glGenFramebuffers(1, &fbo);
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+        std::vector<GLenum> drawBuffers;
+        for (Target t : pass.outputs)
+        {
+            const TargetInfo& target = targets[size_t(t)];
+            GLenum attachment = GL_DEPTH_ATTACHMENT;
+            if (!isDepthFormat(target.desc.format))
+            {
+                attachment = GLenum(GL_COLOR_ATTACHMENT0 + drawBuffers.size());
+                drawBuffers.push_back(attachment);
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment,
+                                   GL_TEXTURE_2D, target.tex, 0);
+        }
+        if (drawBuffers.empty())
+            glDrawBuffer(GL_NONE);
+        else
+            glDrawBuffers(GLsizei(drawBuffers.size()), drawBuffers.data());
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error(
+                std::string(__FUNCTION__) +
+                ": framebuffer of pass " + pass.name + " is not complete");
+
+        fbos[attachments] = fbo;
+        return fbo;
+    }
+
+    /* ------------------------------------------------------------ *
+       Binds the framebuffer of the pass and clears it. Returns
+       false if the pass binds its targets itself.
+     * ------------------------------------------------------------ */
+    bool bindOutputs(const Pass& pass)
+    {
+        if (pass.outputs.empty())
+            return false;
+        for (Target t : pass.outputs)
+            if (targets[size_t(t)].imported)
+                return false;
+
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, framebuffer(pass));
+
+        const glm::ivec2 full = targets[size_t(pass.outputs.front())].desc.size;
+        const glm::ivec2 viewport = pass.viewport == glm::ivec2(0)
+                                  ? full : pass.viewport;
+        opengl_state::viewport(0, 0, viewport.x, viewport.y);
+
+        const glm::vec4& c = pass.clearColor;
+        glClearColor(c.x, c.y, c.z, c.w);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        return true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void execute()
+    {
+        SUNNE_PROFILE_ZONE("OpenGLRenderGraph::execute");
+
+        // Cull from the roots backwards.
+        std::vector<bool> live(passes.size(), false);
+        std::vector<bool> needed(targets.size(), false);
+        for (int i = int(passes.size()) - 1; i >= 0; --i)
+        {
+            const Pass& pass = passes[size_t(i)];
+            bool isLive = pass.root;
+            for (Target t : pass.outputs)
+                isLive = isLive || needed[size_t(t)];
+            if (!isLive)
+                continue;
+
+            live[size_t(i)] = true;
+            for (Target t : pass.inputs)
+                needed[size_t(t)] = true;
+        }
+
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            if (!live[i])
+                continue;
+            for (Target t : passes[i].inputs)
+                targets[size_t(t)].lastUse = int(i);
+            for (Target t : passes[i].outputs)
+                targets[size_t(t)].lastUse = int(i);
+        }
+
+        executed.assign(passes.size(), false);
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            if (!live[i])
+                continue;
+
+            const Pass& pass = passes[i];
+            const bool skip = pass.inputHash != 0 && useCache(pass, needed);
+            if (!skip)
+            {
+                for (Target t : pass.outputs)
+                {
+                    TargetInfo& target = targets[size_t(t)];
+                    if (!target.imported && target.tex == 0)
+                        target.tex = acquire(target.desc);
+                }
+
+                bindOutputs(pass);
+                pass.execute();
+                executed[i] = true;
+            }
+
+            for (Target t : pass.inputs)
+                if (targets[size_t(t)].lastUse == int(i))
+                    releaseTarget(t);
+            for (Target t : pass.outputs)
+                if (targets[size_t(t)].lastUse == int(i))
+                    releaseTarget(t);
+        }
+
+        trimPool();
+        trimCaches();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void releaseTarget(Target t)
+    {
+        TargetInfo& target = targets[size_t(t)];
+        if (target.imported || target.cached || target.tex == 0)
+            return;
+        release(target.tex);
+        target.tex = 0;
+    }
+
+    std::vector<TargetInfo> targets;
+    std::vector<Pass> passes;
+    std::vector<PoolEntry> pool;
+    std::map<std::vector<GLuint>, GLuint> fbos;
+    std::map<std::string, PassCache> caches;
+    std::vector<bool> executed; // of the passes in the latest execute
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLRenderGraph::OpenGLRenderGraph()
+    : impl(std::make_shared<Impl>())
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLRenderGraph::reset()
+{
+    impl->targets.clear();
+    impl->passes.clear();
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLRenderGraph::Target OpenGLRenderGraph::createTarget(const TargetDesc& desc)
+{
+    Impl::TargetInfo target;
+    target.desc = desc;
+    impl->targets.push_back(target);
+    return Target(impl->targets.size() - 1);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLRenderGraph::Target OpenGLRenderGraph::importTexture(GLuint tex)
+{
+    Impl::TargetInfo target;
+    target.tex      = tex;
+    target.imported = true;
+    impl->targets.push_back(target);
+    return Target(impl->targets.size() - 1);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLRenderGraph::addPass(const Pass& pass)
+{ impl->passes.push_back(pass); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLRenderGraph::execute()
+{ impl->execute(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint OpenGLRenderGraph::texture(Target target) const
+{ return impl->targets[size_t(target)].tex; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLRenderGraph::isExecuted(const std::string& pass) const
+{
+    for (size_t i = 0; i < impl->passes.size() && i < impl->executed.size(); ++i)
+        if (impl->passes[i].name == pass)
+            return impl->executed[i];
+    return false;
+}
+
+} // namespace sunne
+} // namespace kuu
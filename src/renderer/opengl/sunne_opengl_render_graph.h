@@ -0,0 +1,111 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLRenderGraph class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   A frame graph of the render passes. The passes declare the
+   targets they read and write and the graph is built again each
+   frame.
+
+   On execute the passes whose outputs are not read by a root pass,
+   directly or through other passes, are culled. The transient
+   targets get their textures from a pool that is kept over the
+   frames. A texture is returned into the pool after the last pass
+   that uses the target, so the targets whose lifetimes do not
+   overlap share the same texture. The pool textures that were not
+   used in the frame are deleted, e.g. after a resize.
+
+   The graph binds a framebuffer of the outputs of a pass, sets the
+   viewport and clears the outputs before the pass is executed. A
+   pass that writes an imported texture binds its targets itself.
+
+   A pass with an input hash is cached. The outputs of a cached pass
+   that other passes read are kept over the frames instead of being
+   taken from the pool, and the pass is not executed while its hash
+   does not change. The rest of its outputs, e.g. the depth, are
+   transient and not allocated when the pass is skipped.
+ * ---------------------------------------------------------------- */
+class OpenGLRenderGraph
+{
+public:
+    using Target = int;
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct TargetDesc
+    {
+        glm::ivec2 size;
+        GLenum format; // internal format, e.g. GL_DEPTH_COMPONENT24
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Pass
+    {
+        std::string name;
+        std::vector<Target> inputs;
+        // Color targets and an optional depth target.
+        std::vector<Target> outputs;
+        // Rendered area at the lower left corner of the outputs.
+        glm::ivec2 viewport = glm::ivec2(0);
+        glm::vec4 clearColor = glm::vec4(0.0f);
+        // A root pass has effects outside of the graph, e.g. it
+        // draws into the window. It is never culled.
+        bool root = false;
+        // Hash of everything the pass reads, zero if the pass is
+        // executed on every frame.
+        uint64_t inputHash = 0;
+        // Frames the pass is still executed after its inputs stop
+        // changing, e.g. a temporal pass converges over frames.
+        int settleFrames = 0;
+        std::function<void()> execute;
+    };
+
+    OpenGLRenderGraph();
+
+    // Removes the passes and the targets of the previous frame.
+    void reset();
+
+    // Declares a transient target.
+    Target createTarget(const TargetDesc& desc);
+    // Declares a texture that is owned outside of the graph.
+    Target importTexture(GLuint tex);
+
+    void addPass(const Pass& pass);
+
+    // Culls the passes, allocates the transient targets and runs
+    // the live passes in the order they were added.
+    void execute();
+
+    // Returns the texture of the target. A transient target has a
+    // texture only while its passes are executed.
+    GLuint texture(Target target) const;
+
+    // Returns true if the pass was executed on the latest execute,
+    // i.e. it was not culled or skipped.
+    bool isExecuted(const std::string& pass) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
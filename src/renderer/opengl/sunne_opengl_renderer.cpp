@@ -7,17 +7,38 @@
 #include <glad/glad.h>
 #include "../sunne_renderer_scene.h"
 #include "sunne_opengl_atmosphere_effect_render.h"
+#include "sunne_opengl_atmosphere_tables.h"
 #include "sunne_opengl_compose.h"
+#include "sunne_opengl_frame_uniforms.h"
 #include "sunne_opengl_loading.h"
 #include "sunne_opengl_planet.h"
+#include "sunne_opengl_render_graph.h"
 #include "sunne_opengl_resources.h"
+#include "sunne_opengl_shader_manager.h"
 #include "sunne_opengl_shading_render.h"
+#include "sunne_opengl_sky.h"
 #include "sunne_opengl_star_effect_render.h"
+#include "sunne_opengl_state.h"
+#include "sunne_opengl_timer_query.h"
+#include "../sunne_render_scale_controller.h"
+#include "../../sunne_hash.h"
 
 namespace kuu
 {
 namespace sunne
 {
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Combines the bytes of the value into the hash. The value must not
+   have padding, e.g. a GLM type or a struct of floats.
+ * ---------------------------------------------------------------- */
+template<typename T>
+uint64_t hashValue(const T& value, uint64_t seed)
+{ return hash::fnv1a(&value, sizeof(T), seed); }
+
+} // anonymous namespace
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
@@ -25,27 +46,151 @@ struct OpenGLRenderer::Impl
 {
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(const glm::ivec2& size)
+    Impl(const glm::ivec2& size, const OpenGLRenderer::Params& params)
         : size(size)
     {
+        shaders          = std::make_shared<OpenGLShaderManager>(
+                               params.shaderHotReload);
         resources        = std::make_shared<OpenGLResources>();
+        frameUniforms    = std::make_shared<OpenGLFrameUniforms>();
         loading          = std::make_shared<OpenGLLoading>();
-        shading          = std::make_shared<OpenGLShadingRender>(size, resources);
-        atmosphereEffect = std::make_shared<OpenGLAtmosphereEffectRender>(size);
-        starEffect       = std::make_shared<OpenGLStarEffectRender>(size);
-        planet           = std::make_shared<OpenGLPlanet>(size);
-        compose          = std::make_shared<OpenGLCompose>();
+        timerShading     = std::make_shared<OpenGLTimerQuery>("shading");
+        timerAtmosphere  = std::make_shared<OpenGLTimerQuery>("atmosphere");
+        timerPlanet      = std::make_shared<OpenGLTimerQuery>("planet");
+        timerStar        = std::make_shared<OpenGLTimerQuery>("star");
+        timerCompose     = std::make_shared<OpenGLTimerQuery>("compose");
+        shading          = std::make_shared<OpenGLShadingRender>(resources);
+        tables           = std::make_shared<OpenGLAtmosphereTables>(shaders);
+        starEffect       = std::make_shared<OpenGLStarEffectRender>(shaders);
+
+        if (params.fusedForward)
+        {
+            sky          = std::make_shared<OpenGLSky>(shaders, tables);
+            planet       = std::make_shared<OpenGLPlanet>(shaders, tables);
+            return;
+        }
+
+        atmosphereEffect = std::make_shared<OpenGLAtmosphereEffectRender>(
+                               size, shaders, tables, params.atmosphereDivisor);
+        atmosphereEffect->temporal = params.atmosphereTemporal;
+        atmosphereEffect->cpu      = params.cpuAtmosphere;
+        planet           = std::make_shared<OpenGLPlanet>(shaders);
+        compose          = std::make_shared<OpenGLCompose>(shaders);
+        compose->exposure = exposure;
+
+        if (params.dynamicResolution)
+        {
+            RenderScaleController::Params scaleParams;
+            scaleParams.targetTime = params.targetFrameTime;
+            scaleParams.minScale   = params.minRenderScale;
+            renderScale = std::make_shared<RenderScaleController>(scaleParams);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        destroyKeptFrame();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void createKeptFrame()
+    {
+        glGenTextures(1, &keptTex);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, keptTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0,
+                     GL_RGBA8, size.x, size.y, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glGenFramebuffers(1, &keptFbo);
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, keptFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+                               GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D,
+                               keptTex,
+                               0);
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        keptSize = size;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void destroyKeptFrame()
+    {
+        opengl_state::deleteFramebuffers(1, &keptFbo);
+        opengl_state::deleteTextures(1, &keptTex);
+    }
+
+    /* ------------------------------------------------------------ *
+       Copies the back buffer of the window into the kept frame.
+     * ------------------------------------------------------------ */
+    void keepFrame()
+    {
+        if (keptSize != size)
+        {
+            destroyKeptFrame();
+            createKeptFrame();
+        }
+
+        opengl_state::bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        opengl_state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, keptFbo);
+        glBlitFramebuffer(0, 0, size.x, size.y,
+                          0, 0, size.x, size.y,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        frameKept = true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    bool presentKeptFrame()
+    {
+        if (!frameKept)
+            return false;
+
+        opengl_state::bindFramebuffer(GL_READ_FRAMEBUFFER, keptFbo);
+        opengl_state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, size.x, size.y,
+                          0, 0, size.x, size.y,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+    /* ------------------------------------------------------------ *
+       Updates the render scale of the offscreen passes from the
+       GPU time of the latest measured frame.
+     * ------------------------------------------------------------ */
+    void updateRenderScale()
+    {
+        double frameTime = 0.0;
+        for (auto timer : { timerShading, timerAtmosphere, timerPlanet,
+                            timerStar, timerCompose })
+        {
+            frameTime += timer->latest();
+        }
+
+        scale = renderScale->update(frameTime);
+        atmosphereEffect->renderScale = scale;
+        compose->texCoordScale =
+            glm::vec2(RenderScaleController::scaledSize(size, scale)) /
+            glm::vec2(size);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void resize(const glm::ivec2& newSize)
     {
+        // The graph targets follow the size, the pool textures of
+        // the old size are deleted after the next frame.
         size = newSize;
-        shading->resize(newSize);
-        atmosphereEffect->resize(newSize);
-        starEffect->resize(newSize);
-        planet->resize(newSize);
+        frameKept = false;
+        if (atmosphereEffect)
+            atmosphereEffect->resize(newSize);
     }
 
     /* ------------------------------------------------------------ *
@@ -61,50 +206,308 @@ struct OpenGLRenderer::Impl
      * ------------------------------------------------------------ */
     void render(std::shared_ptr<RendererScene> scene)
     {
-        shading->draw(scene);
-        atmosphereEffect->draw(scene);
-        planet->setPlanet(scene->planets.front());
-        planet->draw(scene->camera->viewMatrix(),
-                     scene->camera->projectionMatrix());
-        starEffect->draw();
+        frameKept = false;
+        shaders->update();
+        if (sky)
+        {
+            renderFused(scene);
+            return;
+        }
+
+        if (!compose->isReady())
+        {
+            drawLoading();
+            return;
+        }
+
+        if (renderScale)
+            updateRenderScale();
+
+        frameUniforms->update(*scene);
+        const OpenGLFrameUniforms::Block& frame = frameUniforms->block();
+        ++stateFrames;
+
+        using Graph = OpenGLRenderGraph;
+        const glm::ivec2 renderSize =
+            RenderScaleController::scaledSize(size, scale);
+
+        // The input hashes of the cached passes.
+        const uint64_t frameHash = hashValue(renderSize,
+                                   hashValue(size,
+                                   hashValue(frame, hash::Seed)));
+        const RendererScene::Planet& planetScene = *scene->planets.front();
+        const uint64_t shadingHash =
+            hashValue(scene->satellite->matrix(), frameHash);
+        const uint64_t atmosphereHash =
+            hashValue(planetScene.atmosphere,
+            hashValue(scene->camera->cuts,
+            hashValue(shaders->version(), frameHash)));
+        const uint64_t planetHash =
+            hashValue(planetScene.rotation,
+            hashValue(planetScene.inclination,
+            hashValue(planetScene.cloudMapOffset,
+            hashValue(shaders->version(), frameHash))));
 
-        glEnable(GL_DEPTH_TEST);
-        glClearColor(1.0f, 0.2f, 0.2f, 1.0f);
-        glViewport(0, 0, size.x, size.y);
+        graph.reset();
+        const Graph::Target shadingColor = graph.createTarget({ size, GL_RGBA16F });
+        const Graph::Target shadingDepth = graph.createTarget({ size, GL_DEPTH_COMPONENT24 });
+        const Graph::Target planetColor  = graph.createTarget({ size, GL_RGBA16F });
+        const Graph::Target planetDepth  = graph.createTarget({ size, GL_DEPTH_COMPONENT24 });
+        const Graph::Target starColor    = graph.createTarget({ size, GL_RGB16F });
+        // The atmosphere keeps its targets over the frames for the
+        // temporal reprojection and swaps them each frame. The
+        // import only orders the compose after it.
+        const Graph::Target atmosphere   = graph.importTexture(0);
+
+        Graph::Pass shadingPass;
+        shadingPass.name     = "shading";
+        shadingPass.outputs  = { shadingColor, shadingDepth };
+        shadingPass.viewport = renderSize;
+        shadingPass.inputHash = shadingHash;
+        shadingPass.execute  = [&]()
+        {
+            timerShading->begin();
+            shading->draw(scene);
+            timerShading->end();
+        };
+        graph.addPass(shadingPass);
+
+        Graph::Pass atmospherePass;
+        atmospherePass.name    = "atmosphere";
+        atmospherePass.outputs = { atmosphere };
+        atmospherePass.inputHash = atmosphereHash;
+        // The temporal mode renders a quarter of the texels a frame.
+        atmospherePass.settleFrames = atmosphereEffect->temporal ? 4 : 0;
+        atmospherePass.execute = [&]()
+        {
+            timerAtmosphere->begin();
+            atmosphereEffect->draw(scene, frame);
+            timerAtmosphere->end();
+        };
+        graph.addPass(atmospherePass);
+
+        Graph::Pass planetPass;
+        planetPass.name     = "planet";
+        planetPass.outputs  = { planetColor, planetDepth };
+        planetPass.viewport = renderSize;
+        planetPass.inputHash = planetHash;
+        planetPass.execute  = [&]()
+        {
+            timerPlanet->begin();
+            planet->setPlanet(scene->planets.front());
+            planet->draw(frame, renderSize);
+            timerPlanet->end();
+        };
+        graph.addPass(planetPass);
+
+        // The compose does not sample the star effect, the pass is
+        // culled until it does.
+        Graph::Pass starPass;
+        starPass.name     = "star";
+        starPass.outputs  = { starColor };
+        starPass.viewport = renderSize;
+        starPass.execute  = [&]()
+        {
+            timerStar->begin();
+            starEffect->draw();
+            timerStar->end();
+        };
+        graph.addPass(starPass);
+
+        Graph::Pass composePass;
+        composePass.name   = "compose";
+        composePass.inputs = { shadingColor, planetColor, atmosphere };
+        composePass.root   = true;
+        composePass.execute = [&]()
+        {
+            timerCompose->begin();
+            opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+            opengl_state::enable(GL_DEPTH_TEST);
+            glClearColor(1.0f, 0.2f, 0.2f, 1.0f);
+            opengl_state::viewport(0, 0, size.x, size.y);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            compose->shadingTexMap    = graph.texture(shadingColor);
+            compose->atmosphereTexMap       = atmosphereEffect->tex;
+            compose->atmosphereGroundTexMap = atmosphereEffect->groundTex;
+            compose->starTexMap       = 0;
+            compose->planetTexMap     = graph.texture(planetColor);
+            compose->atmosphereTexCoordScale = atmosphereEffect->texCoordScale;
+            compose->draw();
+            timerCompose->end();
+        };
+        graph.addPass(composePass);
+
+        graph.execute();
+
+        // A skipped pass costs nothing, an empty sample keeps the
+        // render scale from following the time of its last execute.
+        for (auto timer : { timerShading, timerAtmosphere, timerPlanet,
+                            timerStar })
+        {
+            if (!graph.isExecuted(timer->name()))
+            {
+                timer->begin();
+                timer->end();
+            }
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Renders the planet, the sky and the satellite directly into
+       the window. The planet and the sky add the in-scattering and
+       tone map their outputs, no offscreen targets are needed.
+     * ------------------------------------------------------------ */
+    void renderFused(std::shared_ptr<RendererScene> scene)
+    {
+        const RendererScene::Atmosphere& atmosphere =
+            scene->planets.front()->atmosphere;
+        if (!tables->update(atmosphere) || !sky->isReady())
+        {
+            drawLoading();
+            return;
+        }
+
+        frameUniforms->update(*scene);
+        const OpenGLFrameUniforms::Block& frame = frameUniforms->block();
+        ++stateFrames;
+
+        using Graph = OpenGLRenderGraph;
+        graph.reset();
+
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        opengl_state::enable(GL_DEPTH_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        opengl_state::viewport(0, 0, size.x, size.y);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        compose->shadingTexMap    = shading->tex;
-        compose->atmosphereTexMap = atmosphereEffect->tex;
-        compose->starTexMap       = starEffect->tex;
-        compose->planetTexMap     = planet->tex;
-        compose->draw();
+
+        Graph::Pass planetPass;
+        planetPass.name    = "planet";
+        planetPass.root    = true;
+        planetPass.execute = [&]()
+        {
+            timerPlanet->begin();
+            planet->setPlanet(scene->planets.front());
+            planet->draw(frame, size, exposure);
+            timerPlanet->end();
+        };
+        graph.addPass(planetPass);
+
+        // The sky is on the far plane behind the planet.
+        Graph::Pass skyPass;
+        skyPass.name    = "atmosphere";
+        skyPass.root    = true;
+        skyPass.execute = [&]()
+        {
+            timerAtmosphere->begin();
+            sky->draw(scene, size, exposure);
+            timerAtmosphere->end();
+        };
+        graph.addPass(skyPass);
+
+        // The satellite is over the planet as in the compose.
+        Graph::Pass shadingPass;
+        shadingPass.name    = "shading";
+        shadingPass.root    = true;
+        shadingPass.execute = [&]()
+        {
+            timerShading->begin();
+            glClear(GL_DEPTH_BUFFER_BIT);
+            shading->draw(scene, exposure);
+            timerShading->end();
+        };
+        graph.addPass(shadingPass);
+
+        graph.execute();
+
+        for (auto timer : { timerStar, timerCompose })
+        {
+            timer->begin();
+            timer->end();
+        }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void renderResourceLoadWait()
     {
+        frameKept = false;
+        shaders->update();
+        drawLoading();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void drawLoading()
+    {
+        opengl_state::bindFramebuffer(GL_FRAMEBUFFER, 0);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glViewport(0, 0, size.x, size.y);
+        opengl_state::viewport(0, 0, size.x, size.y);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         loading->draw();
     }
 
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    std::vector<PassTiming> passTimings() const
+    {
+        std::vector<PassTiming> out;
+        for (auto timer : { timerShading, timerAtmosphere, timerPlanet,
+                            timerStar, timerCompose })
+        {
+            out.push_back({ timer->name(), timer->average() });
+        }
+        return out;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    StateChanges stateChanges()
+    {
+        const opengl_state::Counters counters = opengl_state::counters();
+        opengl_state::resetCounters();
+
+        StateChanges out;
+        out.frames   = stateFrames;
+        out.issued   = counters.issued;
+        out.filtered = counters.filtered;
+        stateFrames = 0;
+        return out;
+    }
+
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     glm::ivec2 size;
+    float scale = 1.0f;
+    float exposure = 0.8f;
+    size_t stateFrames = 0;
+    std::shared_ptr<OpenGLShaderManager> shaders;
     std::shared_ptr<OpenGLResources> resources;
+    std::shared_ptr<OpenGLFrameUniforms> frameUniforms;
     std::shared_ptr<OpenGLLoading> loading;
     std::shared_ptr<OpenGLShadingRender> shading;
+    std::shared_ptr<OpenGLAtmosphereTables> tables;
     std::shared_ptr<OpenGLAtmosphereEffectRender> atmosphereEffect;
+    std::shared_ptr<OpenGLSky> sky;
     std::shared_ptr<OpenGLStarEffectRender> starEffect;
     std::shared_ptr<OpenGLPlanet> planet;
     std::shared_ptr<OpenGLCompose> compose;
+    std::shared_ptr<OpenGLTimerQuery> timerShading;
+    std::shared_ptr<OpenGLTimerQuery> timerAtmosphere;
+    std::shared_ptr<OpenGLTimerQuery> timerPlanet;
+    std::shared_ptr<OpenGLTimerQuery> timerStar;
+    std::shared_ptr<OpenGLTimerQuery> timerCompose;
+    std::shared_ptr<RenderScaleController> renderScale;
+    OpenGLRenderGraph graph;
+    GLuint keptTex = 0;
+    GLuint keptFbo = 0;
+    glm::ivec2 keptSize = glm::ivec2(0);
+    bool frameKept = false;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLRenderer::OpenGLRenderer(const glm::ivec2& size)
-    : impl(std::make_shared<Impl>(size))
+OpenGLRenderer::OpenGLRenderer(const glm::ivec2& size, const Params& params)
+    : impl(std::make_shared<Impl>(size, params))
 {}
 
 /* ---------------------------------------------------------------- *
@@ -127,5 +530,25 @@ void OpenGLRenderer::loadResources(std::shared_ptr<RendererScene> scene)
 void OpenGLRenderer::renderResourceLoadWait()
 { impl->renderResourceLoadWait(); }
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::vector<Renderer::PassTiming> OpenGLRenderer::passTimings() const
+{ return impl->passTimings(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Renderer::StateChanges OpenGLRenderer::stateChanges()
+{ return impl->stateChanges(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLRenderer::keepFrame()
+{ impl->keepFrame(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLRenderer::presentKeptFrame()
+{ return impl->presentKeptFrame(); }
+
 } // namespace sunne
 } // namespace kuu
@@ -30,15 +30,70 @@ namespace sunne
                    planets. The planes are rendered one-by-one using
                    depthbuffer of geometry step. This does not use
                    geometry path parameteric values and ray casts.
+
+   The passes are added into a render graph each frame. The graph
+   culls the passes whose outputs are not composed and shares the
+   textures of the transient targets whose lifetimes do not overlap,
+   e.g. the geometry and the planet depth buffers. The geometry,
+   atmosphere and planet passes are hashed from their inputs and are
+   not rendered again while the camera, the light and their objects
+   stay still, the compose reuses their previous outputs.
+
+   With the dynamic resolution the framebuffers keep the window size
+   and the passes render into a scaled area of them. The scale is
+   updated each frame from the GPU time of the passes.
+
+   The fused forward path renders the planet, the sky and the
+   geometry into the window in one framebuffer, for the GPUs whose
+   memory bandwidth limits the compose.
  * ---------------------------------------------------------------- */
 class OpenGLRenderer : public Renderer
 {
 public:
-    OpenGLRenderer(const glm::ivec2& size);
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Params
+    {
+        // The atmosphere is rendered at the window size divided by
+        // this and upsampled in the compose.
+        int atmosphereDivisor = 2;
+
+        // The atmosphere renders a quarter of its texels each frame
+        // and reprojects the rest from the previous frame.
+        bool atmosphereTemporal = true;
+
+        // The atmosphere is rendered on the CPU and uploaded.
+        bool cpuAtmosphere = false;
+
+        // The offscreen passes are rendered at a fraction of the
+        // window size that is adjusted each frame to keep the GPU
+        // frame time at the target. The compose upscales the
+        // passes into the window.
+        bool dynamicResolution = false;
+        double targetFrameTime = 14.0; // milliseconds
+        float minRenderScale   = 0.5f;
+
+        // The shader files are watched and the changed programs
+        // are rebuilt while running.
+        bool shaderHotReload = false;
+
+        // The planet and the sky are rendered directly into the
+        // window with the in-scattering and the tone mapping in
+        // their fragment shaders, without the offscreen targets and
+        // the compose. The atmosphere divisor, the CPU atmosphere
+        // and the dynamic resolution are not used.
+        bool fusedForward = false;
+    };
+
+    OpenGLRenderer(const glm::ivec2& size, const Params& params);
     virtual void resize(const glm::ivec2& size) override;
     virtual void render(std::shared_ptr<RendererScene> scene) override;
     virtual void loadResources(std::shared_ptr<RendererScene> scene) override;
     virtual void renderResourceLoadWait() override;
+    virtual std::vector<PassTiming> passTimings() const override;
+    virtual StateChanges stateChanges() override;
+    virtual void keepFrame() override;
+    virtual bool presentKeptFrame() override;
 
 private:
     struct Impl;
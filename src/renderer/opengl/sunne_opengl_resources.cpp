@@ -43,12 +43,11 @@ OpenGLResources::OpenGLResources()
 //    return out;
 //}
 
-std::shared_ptr<OpenGLSatellite> OpenGLResources::openglSatellite(
-    std::shared_ptr<RendererScene::Satellite> satellite)
+std::shared_ptr<OpenGLSatellite> OpenGLResources::openglSatellite()
 {
     if (!impl->satellite)
     {
-        impl->satellite = std::make_shared<OpenGLSatellite>(satellite);
+        impl->satellite = std::make_shared<OpenGLSatellite>();
         impl->satellite->loadResources();
     }
     return impl->satellite;
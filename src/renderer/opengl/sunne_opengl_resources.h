@@ -28,8 +28,7 @@ public:
 //    std::shared_ptr<OpenGLPlanet> openglPlanet(
 //        std::shared_ptr<RendererScene::Planet> planet,
 //        const glm::ivec2& size);
-    std::shared_ptr<OpenGLSatellite> openglSatellite(
-        std::shared_ptr<RendererScene::Satellite> satellite);
+    std::shared_ptr<OpenGLSatellite> openglSatellite();
 
 private:
     struct Impl;
@@ -14,9 +14,12 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glad/glad.h>
+#include "sunne_opengl_frame_uniforms.h"
 #include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_state.h"
 #include "sunne_opengl_texture_loader.h"
 #include "../sunne_pbr_model_importer.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
@@ -29,6 +32,11 @@ namespace sunne
 
 using namespace glm;
 
+/* ---------------------------------------------------------------- *
+   First texture unit of the pass.
+ * ---------------------------------------------------------------- */
+const GLuint TextureUnit = opengl_state::texture_unit::Satellite;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 struct OpenGLSatellite::Impl
@@ -51,8 +59,7 @@ struct OpenGLSatellite::Impl
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(std::shared_ptr<RendererScene::Satellite> satellite)
-        : satellite(satellite)
+    Impl()
     {
         createShader();
     }
@@ -64,8 +71,6 @@ struct OpenGLSatellite::Impl
         pgm = opengl_shader_loader::load(
                 "shaders/sunne_opengl_satellite.vsh",
                 "shaders/sunne_opengl_satellite.fsh");
-        uniformProjectionMatrix = glGetUniformLocation(pgm, "matrices.projection");
-        uniformViewMatrix       = glGetUniformLocation(pgm, "matrices.view");
         uniformModelMatrix      = glGetUniformLocation(pgm, "matrices.model");
         uniformNormalMatrix     = glGetUniformLocation(pgm, "matrices.normal");
         uniformAlbedoMap        = glGetUniformLocation(pgm, "albedoMap");
@@ -73,13 +78,15 @@ struct OpenGLSatellite::Impl
         uniformSpecularMap      = glGetUniformLocation(pgm, "specularMap");
         uniformCloudMap         = glGetUniformLocation(pgm, "cloudMap");
         uniformNightMap         = glGetUniformLocation(pgm, "nightMap");
+        uniformExposure         = glGetUniformLocation(pgm, "exposure");
+        OpenGLFrameUniforms::bind(pgm);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void destroyShader()
     {
-        glDeleteProgram(pgm);
+        opengl_state::deleteProgram(pgm);
     }
 
     /* ------------------------------------------------------------ *
@@ -113,6 +120,9 @@ struct OpenGLSatellite::Impl
 
         std::cout << vertexData.size() << ", " << indexData.size() << std::endl;
 
+        // The element buffer binding belongs to the bound vertex
+        // array, a pass leaves its array bound after the draw.
+        opengl_state::bindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
         glBufferData(GL_ARRAY_BUFFER,
                      GLsizeiptr(vertexData.size() * sizeof(float)),
@@ -128,7 +138,7 @@ struct OpenGLSatellite::Impl
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         glGenVertexArrays(1, &mesh.vao);
-        glBindVertexArray(mesh.vao);
+        opengl_state::bindVertexArray(mesh.vao);
         glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
         glEnableVertexAttribArray(0);
@@ -153,7 +163,7 @@ struct OpenGLSatellite::Impl
                               BUFFER_OFFSET(11 * sizeof(float)));
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        opengl_state::bindVertexArray(0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
@@ -205,8 +215,7 @@ struct OpenGLSatellite::Impl
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void draw(const glm::mat4& viewMatrix,
-              const glm::mat4& projectionMatrix)
+    void draw(const RendererScene::Satellite& satellite, float exposure)
     {
         for (Mesh& mesh : meshes)
         {
@@ -217,36 +226,30 @@ struct OpenGLSatellite::Impl
             createTextures(mesh);
         }
 
+        // The camera is in the frame uniforms, the meshes share the
+        // model matrices.
+        const glm::mat4 modelMatrix  = satellite.matrix();
+        const glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(modelMatrix));
+
+        opengl_state::useProgram(pgm);
+        glUniformMatrix4fv(uniformModelMatrix, 1,
+                           GL_FALSE, glm::value_ptr(modelMatrix));
+        glUniformMatrix3fv(uniformNormalMatrix, 1,
+                           GL_FALSE, glm::value_ptr(normalMatrix));
+        glUniform1i(uniformAlbedoMap,   TextureUnit);
+        glUniform1f(uniformExposure,    exposure);
+
         for (Mesh& mesh : meshes)
         {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mesh.texAlbedo);
-
-            const glm::mat4 modelMatrix  = satellite->matrix();
-            const glm::mat3 normalMatrix = glm::mat3(glm::inverseTranspose(modelMatrix));
-
-            glUseProgram(pgm);
-            glUniformMatrix4fv(uniformModelMatrix, 1,
-                               GL_FALSE, glm::value_ptr(modelMatrix));
-            glUniformMatrix4fv(uniformViewMatrix, 1,
-                               GL_FALSE, glm::value_ptr(viewMatrix));
-            glUniformMatrix4fv(uniformProjectionMatrix, 1,
-                               GL_FALSE, glm::value_ptr(projectionMatrix));
-            glUniformMatrix3fv(uniformNormalMatrix, 1,
-                               GL_FALSE, glm::value_ptr(normalMatrix));
-            glUniform1i(uniformAlbedoMap,   0);
-//
-            glBindVertexArray(mesh.vao);
+            opengl_state::bindTexture(TextureUnit, GL_TEXTURE_2D, mesh.texAlbedo);
+
+            opengl_state::bindVertexArray(mesh.vao);
             glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
         }
     }
 
-    std::shared_ptr<RendererScene::Satellite> satellite;
     std::vector<Mesh> meshes;
     GLuint pgm = 0;
-    GLint uniformProjectionMatrix;
-    GLint uniformViewMatrix;
     GLint uniformModelMatrix;
     GLint uniformNormalMatrix;
     GLint uniformAlbedoMap;
@@ -254,12 +257,13 @@ struct OpenGLSatellite::Impl
     GLint uniformSpecularMap;
     GLint uniformCloudMap;
     GLint uniformNightMap;
+    GLint uniformExposure;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLSatellite::OpenGLSatellite(std::shared_ptr<RendererScene::Satellite> satellite)
-    : impl(std::make_shared<Impl>(satellite))
+OpenGLSatellite::OpenGLSatellite()
+    : impl(std::make_shared<Impl>())
 {}
 
 /* ---------------------------------------------------------------- *
@@ -269,9 +273,12 @@ void OpenGLSatellite::loadResources()
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-void OpenGLSatellite::draw(const glm::mat4& view,
-                           const glm::mat4& projection)
-{ impl->draw(view, projection); }
+void OpenGLSatellite::draw(const RendererScene::Satellite& satellite,
+                           float exposure)
+{
+    SUNNE_PROFILE_ZONE("OpenGLSatellite::draw");
+    impl->draw(satellite, exposure);
+}
 
 } // namespace sunne
 } // namespace kuu
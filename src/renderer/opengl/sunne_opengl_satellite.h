@@ -19,11 +19,14 @@ namespace sunne
 class OpenGLSatellite
 {
 public:
-    OpenGLSatellite(std::shared_ptr<RendererScene::Satellite> satellite);
+    OpenGLSatellite();
 
     void loadResources();
-    void draw(const glm::mat4& view,
-              const glm::mat4& projection);
+    // Draws the satellite with the camera of the bound frame
+    // uniforms. A positive exposure tone maps the output for the
+    // window.
+    void draw(const RendererScene::Satellite& satellite,
+              float exposure = 0.0f);
 
 private:
     struct Impl;
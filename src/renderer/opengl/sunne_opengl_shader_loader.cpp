@@ -5,10 +5,23 @@
 
 #include "sunne_opengl_shader_loader.h"
 #include <array>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include "sunne_opengl_extensions.h"
+#include "../../sunne_file_cache.h"
+#include "../../sunne_hash.h"
+#include "../../sunne_mapped_file.h"
+#include "../../sunne_profiler.h"
+
+/* ---------------------------------------------------------------- *
+   GL_KHR_parallel_shader_compile, not in the generated loader.
+ * ---------------------------------------------------------------- */
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace kuu
 {
@@ -19,6 +32,8 @@ namespace opengl_shader_loader
 namespace 
 {
 
+using opengl_extensions::hasExtension;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 std::string readTextFile(const std::string& path)
@@ -30,10 +45,192 @@ std::string readTextFile(const std::string& path)
 }
 
 /* ---------------------------------------------------------------- *
+   Replaces the #include "file" lines of the shader source with the
+   content of the file. The path is relative to the directory of the
+   shader. Includes of the included file are not resolved. The
+   paths of the included files are appended into files.
+ * ---------------------------------------------------------------- */
+std::string resolveIncludes(const std::string& source,
+                            const std::string& shaderPath,
+                            std::vector<std::string>& files)
+{
+    const std::string directive = "#include";
+    const size_t slash = shaderPath.find_last_of("/\\");
+    const std::string dir = slash == std::string::npos
+        ? std::string()
+        : shaderPath.substr(0, slash + 1);
+
+    std::istringstream in(source);
+    std::string out;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        const size_t pos   = line.find_first_not_of(" \t");
+        const size_t begin = line.find('"');
+        const size_t end   = begin == std::string::npos
+            ? std::string::npos
+            : line.find('"', begin + 1);
+        if (pos == std::string::npos ||
+            line.compare(pos, directive.size(), directive) != 0 ||
+            end == std::string::npos)
+        {
+            out += line + "\n";
+            continue;
+        }
+
+        const std::string path = dir + line.substr(begin + 1, end - begin - 1);
+        const std::string include = readTextFile(path);
+        files.push_back(path);
+        if (include.size() == 0)
+            std::cerr << "Shader include "
+                      << path
+                      << " is empty string"
+                      << std::endl;
+        out += include + "\n";
+    }
+    return out;
+}
+
+/* ---------------------------------------------------------------- *
+   Layout of the program binary cache file:
+
+    1) header
+    2) program binary of header.size bytes in header.format
+
+   The file name is the hash of the shader sources and of the
+   driver. Increase the version when the layout changes.
+ * ---------------------------------------------------------------- */
+const char CacheMagic[8] = { 'S', 'U', 'N', 'N', 'E', 'P', 'G', 'M' };
+const uint32_t CacheVersion = 1;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t size;
+};
+
+/* ---------------------------------------------------------------- *
+   Returns true if the driver can save and load program binaries.
+   The functions are core since 4.1, on the 3.3 context they come
+   from the extension, see loadExtensions. Some drivers have the
+   functions but no binary formats, e.g. Mesa with its own shader
+   cache disabled.
+ * ---------------------------------------------------------------- */
+bool programBinarySupported()
+{
+    if (!GLAD_GL_VERSION_4_1 && !hasExtension("GL_ARB_get_program_binary"))
+        return false;
+    if (!glad_glGetProgramBinary || !glad_glProgramBinary || !glad_glProgramParameteri)
+        return false;
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+/* ---------------------------------------------------------------- *
+   Hash of the program sources and of the driver. A binary is valid
+   only for the driver that created it.
+ * ---------------------------------------------------------------- */
+uint64_t cacheKey(const std::string& vsh, const std::string& fsh)
+{
+    uint64_t key = hash::fnv1a(vsh);
+    key = hash::fnv1a(fsh, key);
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const GLubyte* str = glGetString(name);
+        if (str)
+            key = hash::fnv1a(std::string(reinterpret_cast<const char*>(str)), key);
+        key = hash::fnv1a(&name, sizeof(name), key);
+    }
+    return key;
+}
+
+/* ---------------------------------------------------------------- *
+   Creates the program from the cache file. Returns 0 if the file
+   does not exist or the driver rejects the binary, e.g. after a
+   driver update that did not change the version string.
+ * ---------------------------------------------------------------- */
+GLuint readCache(const std::string& cachePath)
+{
+    SUNNE_PROFILE_ZONE("opengl_shader_loader::readCache");
+
+    MappedFile file(cachePath);
+    if (!file.isOpen() || file.size() < sizeof(CacheHeader))
+        return 0;
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(CacheHeader));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        header.version != CacheVersion ||
+        header.size != file.size() - sizeof(CacheHeader))
+    {
+        return 0;
+    }
+
+    GLuint pgm = glCreateProgram();
+    glProgramBinary(pgm, GLenum(header.format),
+                    file.data() + sizeof(CacheHeader),
+                    GLsizei(header.size));
+
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(pgm, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE)
+    {
+        glDeleteProgram(pgm);
+        return 0;
+    }
+    return pgm;
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the binary of the linked program into the cache file.
+ * ---------------------------------------------------------------- */
+void writeCache(const std::string& cachePath, GLuint pgm)
+{
+    GLint length = 0;
+    glGetProgramiv(pgm, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<unsigned char> binary(size_t(length), 0);
+    GLenum format = 0;
+    glGetProgramBinary(pgm, length, &length, &format, binary.data());
+    if (length <= 0)
+        return;
+
+    CacheHeader header;
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.format  = uint32_t(format);
+    header.size    = uint64_t(length);
+
+    file_cache::write(cachePath,
+    {
+        { &header,       sizeof(CacheHeader) },
+        { binary.data(), size_t(length) }
+    });
+}
+
+/* ---------------------------------------------------------------- *
+   Returns true if the driver compiles and links in its own threads
+   and the completion can be polled.
+ * ---------------------------------------------------------------- */
+bool parallelCompileSupported()
+{
+    return hasExtension("GL_KHR_parallel_shader_compile") ||
+           hasExtension("GL_ARB_parallel_shader_compile");
+}
+
+/* ---------------------------------------------------------------- *
+   Issues the compile of the shader. The status is checked later in
+   checkShader so that the driver can compile in the background.
  * ---------------------------------------------------------------- */
-GLuint loadShader(const GLenum type, const std::string& shaderPath)
+GLuint compileShader(const GLenum type,
+                     const std::string& shaderPath,
+                     const std::string& source)
 {
-    std::string source = readTextFile(shaderPath);
     if (source.size() == 0)
     {
         std::cerr << "Shader source "
@@ -47,7 +244,18 @@ GLuint loadShader(const GLenum type, const std::string& shaderPath)
     GLuint shr = glCreateShader(type);
     glShaderSource(shr, 1, &cts, nullptr);
     glCompileShader(shr);
-    
+    return shr;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool checkShader(GLuint shr,
+                 const std::string& shaderPath,
+                 const std::string& source)
+{
+    if (shr == 0)
+        return false;
+
     GLint status = GL_FALSE;
     glGetShaderiv(shr, GL_COMPILE_STATUS, &status);
     if (status != GL_TRUE)
@@ -68,51 +276,139 @@ GLuint loadShader(const GLenum type, const std::string& shaderPath)
         msg += std::string("Log: ")      += log  += "\n";
         msg += std::string("Source: ")   += source;
         std::cerr << msg << std::endl;
-        return 0;
+        return false;
     }
     
-    return shr;
+    return true;
 }
     
 } // anonymous namespace
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-GLuint load(const std::string& vshPath,
+void loadExtensions(GLADloadproc load)
+{
+    if (GLAD_GL_VERSION_4_1 || !hasExtension("GL_ARB_get_program_binary"))
+        return;
+
+    glad_glGetProgramBinary  = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(load("glGetProgramBinary"));
+    glad_glProgramBinary     = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(load("glProgramBinary"));
+    glad_glProgramParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(load("glProgramParameteri"));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Build begin(const std::string& vshPath,
             const std::string& fshPath)
 {
-    GLuint vsh = loadShader(GL_VERTEX_SHADER,   vshPath);
-    GLuint fsh = loadShader(GL_FRAGMENT_SHADER, fshPath);
-    
-    GLuint pgm = glCreateProgram();
-    glAttachShader(pgm, vsh);
-    glAttachShader(pgm, fsh);
-    glLinkProgram(pgm);
-    
+    SUNNE_PROFILE_ZONE("opengl_shader_loader::begin");
+
+    Build build;
+    build.vshPath = vshPath;
+    build.fshPath = fshPath;
+    build.files   = { vshPath, fshPath };
+    build.vshSource =
+        resolveIncludes(readTextFile(vshPath), vshPath, build.files);
+    build.fshSource =
+        resolveIncludes(readTextFile(fshPath), fshPath, build.files);
+
+    static const bool binarySupported = programBinarySupported();
+    if (binarySupported)
+    {
+        const uint64_t key = cacheKey(build.vshSource, build.fshSource);
+        build.cachePath = file_cache::path("shaders", key, ".pgm");
+        build.pgm = readCache(build.cachePath);
+        build.fromCache = build.pgm != 0;
+        if (build.fromCache)
+            return build;
+    }
+
+    build.vsh = compileShader(GL_VERTEX_SHADER,   vshPath, build.vshSource);
+    build.fsh = compileShader(GL_FRAGMENT_SHADER, fshPath, build.fshSource);
+
+    build.pgm = glCreateProgram();
+    if (!build.cachePath.empty())
+        glProgramParameteri(build.pgm, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (build.vsh)
+        glAttachShader(build.pgm, build.vsh);
+    if (build.fsh)
+        glAttachShader(build.pgm, build.fsh);
+    glLinkProgram(build.pgm);
+    return build;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool isCompleted(const Build& build)
+{
+    static const bool parallel = parallelCompileSupported();
+    if (!parallel || build.pgm == 0 || build.fromCache)
+        return true;
+
+    GLint completed = GL_TRUE;
+    glGetProgramiv(build.pgm, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint finish(Build& build)
+{
+    SUNNE_PROFILE_ZONE("opengl_shader_loader::finish");
+
+    // Loaded from the cache.
+    if (build.fromCache)
+        return build.pgm;
+
+    const bool vshOk = checkShader(build.vsh, build.vshPath, build.vshSource);
+    const bool fshOk = checkShader(build.fsh, build.fshPath, build.fshSource);
+
     GLint linkStatus = 0;
-    glGetProgramiv(pgm, GL_LINK_STATUS, &linkStatus);
+    glGetProgramiv(build.pgm, GL_LINK_STATUS, &linkStatus);
     if (linkStatus != GL_TRUE)
     {
-        GLint length;
-        glGetProgramiv(pgm, GL_INFO_LOG_LENGTH, &length);
-        
-        std::string log;
-        log.resize(size_t(length + 1));
+        if (vshOk && fshOk)
+        {
+            GLint length;
+            glGetProgramiv(build.pgm, GL_INFO_LOG_LENGTH, &length);
 
-        char* logData = const_cast<char*>(log.c_str());
-        GLchar* glLogData = reinterpret_cast<GLchar*>(logData);
-        glGetProgramInfoLog(pgm, length, nullptr, glLogData);
-                        
-        std::string msg;
-        msg += "Failed to link program.\n";
-        msg += std::string("Log: ") += log  += "\n";
-        std::cerr << msg << std::endl;
+            std::string log;
+            log.resize(size_t(length + 1));
+
+            char* logData = const_cast<char*>(log.c_str());
+            GLchar* glLogData = reinterpret_cast<GLchar*>(logData);
+            glGetProgramInfoLog(build.pgm, length, nullptr, glLogData);
+
+            std::string msg;
+            msg += "Failed to link program.\n";
+            msg += std::string("Log: ") += log  += "\n";
+            std::cerr << msg << std::endl;
+        }
+        glDeleteProgram(build.pgm);
+        build.pgm = 0;
+    }
+    else if (!build.cachePath.empty())
+    {
+        writeCache(build.cachePath, build.pgm);
     }
 
-    glDeleteShader(vsh);
-    glDeleteShader(fsh);
-    
-    return pgm;
+    glDeleteShader(build.vsh);
+    glDeleteShader(build.fsh);
+    build.vsh = 0;
+    build.fsh = 0;
+
+    return build.pgm;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint load(const std::string& vshPath,
+            const std::string& fshPath)
+{
+    SUNNE_PROFILE_ZONE("opengl_shader_loader::load");
+
+    Build build = begin(vshPath, fshPath);
+    return finish(build);
 }
 
 } // namespace opengl_shader_loader
@@ -16,6 +16,59 @@ namespace sunne
 namespace opengl_shader_loader
 {
 
+/* ---------------------------------------------------------------- *
+   A program whose compile and link have been issued to the driver.
+ * ---------------------------------------------------------------- */
+struct Build
+{
+    GLuint pgm = 0;
+    GLuint vsh = 0;
+    GLuint fsh = 0;
+    bool fromCache = false;         // the program is linked already
+    std::string vshPath;
+    std::string fshPath;
+    std::string vshSource;
+    std::string fshSource;
+    std::string cachePath;          // empty if the cache is not used
+    std::vector<std::string> files; // the shader and included files
+};
+
+/* ---------------------------------------------------------------- *
+   Loads the entry points of GL_ARB_get_program_binary. The generated
+   loader loads them only with the 4.1 core, the program binary cache
+   uses the extension on an older context. Call after the OpenGL has
+   been loaded.
+ * ---------------------------------------------------------------- */
+void loadExtensions(GLADloadproc load);
+
+/* ---------------------------------------------------------------- *
+   Reads the sources and issues the compile and link of the program
+   without waiting for them. The program is loaded from the cache
+   if possible.
+ * ---------------------------------------------------------------- */
+Build begin(const std::string& vshPath,
+            const std::string& fshPath);
+
+/* ---------------------------------------------------------------- *
+   Returns true if the driver has finished the build. Without the
+   parallel shader compile extension the build is always reported
+   completed and finish blocks.
+ * ---------------------------------------------------------------- */
+bool isCompleted(const Build& build);
+
+/* ---------------------------------------------------------------- *
+   Checks the compile and link status, prints the logs and writes
+   the program into the cache. Returns the program or 0 if the
+   build failed.
+ * ---------------------------------------------------------------- */
+GLuint finish(Build& build);
+
+/* ---------------------------------------------------------------- *
+   Loads the program from the vertex and fragment shader files. The
+   linked program binary is saved into the file cache and loaded
+   from there while the sources and the driver stay the same.
+   Blocks until the program is linked.
+ * ---------------------------------------------------------------- */
 GLuint load(const std::string& vshPath,
             const std::string& fshPath);
 
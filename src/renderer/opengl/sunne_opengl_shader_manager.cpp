@@ -0,0 +1,199 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLShaderManager class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_shader_manager.h"
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_state.h"
+#include "../../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Returns the modification time of the file or 0 if the file does
+   not exist.
+ * ---------------------------------------------------------------- */
+time_t modificationTime(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return 0;
+    return info.st_mtime;
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLShaderManager::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Entry
+    {
+        std::string vshPath;
+        std::string fshPath;
+        LinkedCallback onLinked;
+        GLuint pgm = 0;
+        bool building = false;
+        opengl_shader_loader::Build build;
+        std::vector<time_t> times; // of the build files
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(bool watch)
+        : watch(watch)
+        , lastCheck(Clock::now())
+    {}
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        for (Entry& e : entries)
+        {
+            if (e.building)
+                destroyBuild(e);
+            opengl_state::deleteProgram(e.pgm);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void startBuild(Entry& e)
+    {
+        e.build    = opengl_shader_loader::begin(e.vshPath, e.fshPath);
+        e.building = true;
+        e.times.clear();
+        for (const std::string& path : e.build.files)
+            e.times.push_back(modificationTime(path));
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void destroyBuild(Entry& e)
+    {
+        glDeleteShader(e.build.vsh);
+        glDeleteShader(e.build.fsh);
+        glDeleteProgram(e.build.pgm);
+        e.building = false;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void finishBuild(Entry& e)
+    {
+        e.building = false;
+        const GLuint pgm = opengl_shader_loader::finish(e.build);
+        if (pgm == 0)
+        {
+            // Keep the previous program of a failed rebuild.
+            if (e.pgm)
+                std::cerr << "Keeping the previous program of "
+                          << e.fshPath << std::endl;
+            return;
+        }
+
+        e.onLinked(pgm);
+        opengl_state::deleteProgram(e.pgm);
+        e.pgm = pgm;
+        version++;
+    }
+
+    /* ------------------------------------------------------------ *
+       Returns true if a file of the entry has been modified after
+       the build was started.
+     * ------------------------------------------------------------ */
+    bool isModified(const Entry& e) const
+    {
+        for (size_t i = 0; i < e.build.files.size(); ++i)
+            if (modificationTime(e.build.files[i]) != e.times[i])
+                return true;
+        return false;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void update()
+    {
+        SUNNE_PROFILE_ZONE("OpenGLShaderManager::update");
+
+        for (Entry& e : entries)
+            if (e.building && opengl_shader_loader::isCompleted(e.build))
+                finishBuild(e);
+
+        if (!watch)
+            return;
+
+        // The files are checked a couple of times per second, an
+        // editor can save the file in several writes.
+        const Clock::time_point now = Clock::now();
+        if (now - lastCheck < std::chrono::milliseconds(500))
+            return;
+        lastCheck = now;
+
+        for (Entry& e : entries)
+        {
+            if (!isModified(e))
+                continue;
+            if (e.building)
+                destroyBuild(e);
+            std::cout << "Rebuilding " << e.vshPath << ", "
+                      << e.fshPath << std::endl;
+            startBuild(e);
+        }
+    }
+
+    std::vector<Entry> entries;
+    bool watch;
+    Clock::time_point lastCheck;
+    size_t version = 0;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLShaderManager::OpenGLShaderManager(bool watch)
+    : impl(std::make_shared<Impl>(watch))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLShaderManager::add(const std::string& vshPath,
+                              const std::string& fshPath,
+                              LinkedCallback onLinked)
+{
+    Impl::Entry e;
+    e.vshPath  = vshPath;
+    e.fshPath  = fshPath;
+    e.onLinked = onLinked;
+    impl->startBuild(e);
+    impl->entries.push_back(e);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLShaderManager::update()
+{ impl->update(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+size_t OpenGLShaderManager::version() const
+{ return impl->version; }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,63 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLShaderManager class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Builds the programs of the passes without blocking the render
+   thread. All the builds are issued when the programs are added and
+   update polls them, with the parallel shader compile extension the
+   driver compiles them in its own threads meanwhile. A pass renders
+   its fallback until its program has been linked.
+
+   If watching is enabled then the shader files and their includes
+   are checked for changes and the changed programs are rebuilt. The
+   old program is used until the new one has been linked, a program
+   that fails to build is not replaced.
+
+   The manager owns the programs. It must be used from the thread
+   that renders.
+ * ---------------------------------------------------------------- */
+class OpenGLShaderManager
+{
+public:
+    // Called with the linked program. The previous program of the
+    // same entry is deleted after the call.
+    using LinkedCallback = std::function<void(GLuint pgm)>;
+
+    OpenGLShaderManager(bool watch = false);
+
+    // Issues the build of the program. The callback is called from
+    // update when the program has been linked and again after each
+    // successful rebuild.
+    void add(const std::string& vshPath,
+             const std::string& fshPath,
+             LinkedCallback onLinked);
+
+    // Finishes the completed builds and starts the rebuild of the
+    // changed programs. Call once per frame.
+    void update();
+
+    // Returns the count of the linked programs. The output of a pass
+    // can change when it is incremented.
+    size_t version() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
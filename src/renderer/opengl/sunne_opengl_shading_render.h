@@ -24,12 +24,12 @@ class RendererScene;
 class OpenGLShadingRender
 {
 public:
-    OpenGLShadingRender(const glm::ivec2& size, std::shared_ptr<OpenGLResources> resources);
-    void resize(const glm::ivec2& size);
+    OpenGLShadingRender(std::shared_ptr<OpenGLResources> resources);
     void load(std::shared_ptr<RendererScene> scene);
-    void draw(std::shared_ptr<RendererScene> scene);
-
-    GLuint tex = 0;
+    // Draws into the bound framebuffer. A positive exposure tone
+    // maps the output for the window.
+    void draw(std::shared_ptr<RendererScene> scene,
+              float exposure = 0.0f);
 
 private:
     struct Impl;
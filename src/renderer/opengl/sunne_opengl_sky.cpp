@@ -0,0 +1,142 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLSky class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_sky.h"
+#include "sunne_opengl_atmosphere_tables.h"
+#include "sunne_opengl_frame_uniforms.h"
+#include "sunne_opengl_ndc_mesh.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
+#include "../sunne_renderer_scene.h"
+#include "../../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+// The scattering map, shared with the atmosphere pass.
+const GLuint TextureUnit = opengl_state::texture_unit::Atmosphere;
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLSky::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(std::shared_ptr<OpenGLShaderManager> shaders,
+         std::shared_ptr<OpenGLAtmosphereTables> tables)
+        : tables(tables)
+    {
+        createShader(shaders);
+        createMesh();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        destroyMesh();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
+    {
+        shaders->add(
+                "shaders/sunne_opengl_sky.vsh",
+                "shaders/sunne_opengl_sky.fsh",
+                [this](GLuint linked)
+        {
+            pgm = linked;
+            uniformViewport = glGetUniformLocation(pgm, "viewport");
+            uniformExposure = glGetUniformLocation(pgm, "exposure");
+            uniformAtmosphere.locate(pgm);
+            OpenGLFrameUniforms::bind(pgm);
+            opengl_state::useProgram(pgm);
+            glUniform1i(glGetUniformLocation(pgm, "scatteringMap"), TextureUnit);
+        });
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void createMesh()
+    {
+        ndcQuad = std::make_shared<NdcQuadMesh>();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void destroyMesh()
+    {
+        ndcQuad.reset();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    bool isReady() const
+    {
+        return pgm && tables->isReady();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void draw(std::shared_ptr<RendererScene> scene,
+              const glm::ivec2& viewport,
+              float exposure)
+    {
+        if (!isReady())
+            return;
+
+        opengl_state::useProgram(pgm);
+        glUniform2f(uniformViewport, float(viewport.x), float(viewport.y));
+        glUniform1f(uniformExposure, exposure);
+        uniformAtmosphere.set(scene->planets.front()->atmosphere);
+        opengl_state::bindTexture(TextureUnit, GL_TEXTURE_3D, tables->scatteringTex());
+
+        // The quad is at the cleared depth.
+        opengl_state::depthFunc(GL_LEQUAL);
+        ndcQuad->draw();
+        opengl_state::depthFunc(GL_LESS);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    std::shared_ptr<OpenGLAtmosphereTables> tables;
+    GLuint pgm = 0;
+    GLint uniformViewport;
+    GLint uniformExposure;
+    OpenGLAtmosphereUniforms uniformAtmosphere;
+    std::shared_ptr<NdcQuadMesh> ndcQuad;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLSky::OpenGLSky(std::shared_ptr<OpenGLShaderManager> shaders,
+                     std::shared_ptr<OpenGLAtmosphereTables> tables)
+    : impl(std::make_shared<Impl>(shaders, tables))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool OpenGLSky::isReady() const
+{ return impl->isReady(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLSky::draw(std::shared_ptr<RendererScene> scene,
+                     const glm::ivec2& viewport,
+                     float exposure)
+{
+    SUNNE_PROFILE_ZONE("OpenGLSky::draw");
+    impl->draw(scene, viewport, exposure);
+}
+
+} // namespace sunne
+} // namespace kuu
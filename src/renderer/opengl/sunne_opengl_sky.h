@@ -0,0 +1,48 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLSky class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+class OpenGLAtmosphereTables;
+class OpenGLShaderManager;
+class RendererScene;
+
+/* ---------------------------------------------------------------- *
+   Draws the in-scattering of the view rays that miss the planet
+   into the bound framebuffer of the fused forward path. The sky is
+   drawn after the planet on the far plane, the depth test leaves
+   the planet fragments. The output is tone mapped.
+ * ---------------------------------------------------------------- */
+class OpenGLSky
+{
+public:
+    OpenGLSky(std::shared_ptr<OpenGLShaderManager> shaders,
+              std::shared_ptr<OpenGLAtmosphereTables> tables);
+
+    // Returns true when the program and the tables can be used.
+    bool isReady() const;
+
+    // Draws with the camera of the bound frame uniforms. The tables
+    // must have been updated.
+    void draw(std::shared_ptr<RendererScene> scene,
+              const glm::ivec2& viewport,
+              float exposure);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -5,7 +5,9 @@
  
 #include "sunne_opengl_star_effect_render.h"
 #include "sunne_opengl_ndc_mesh.h"
-#include "sunne_opengl_shader_loader.h"
+#include "sunne_opengl_shader_manager.h"
+#include "sunne_opengl_state.h"
+#include "../../sunne_profiler.h"
 
 namespace kuu
 {
@@ -18,14 +20,9 @@ struct OpenGLStarEffectRender::Impl
 {
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(const glm::ivec2& size, OpenGLStarEffectRender* self)
-        : size(size)
-        , self(self)
+    Impl(std::shared_ptr<OpenGLShaderManager> shaders)
     {
-        createTexture();
-        createRenderbuffer();
-        createFramebuffer();
-        createShader();
+        createShader(shaders);
         createMesh();
     }
 
@@ -34,91 +31,16 @@ struct OpenGLStarEffectRender::Impl
     ~Impl()
     {
         destroyMesh();
-        destroyShader();
-        destroyFramebuffer();
-        destroyRenderbuffer();
-        destroyTexture();
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createTexture()
+    void createShader(std::shared_ptr<OpenGLShaderManager> shaders)
     {
-        glGenTextures(1, &self->tex);
-        glBindTexture(GL_TEXTURE_2D, self->tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0,
-                     GL_RGB16F, size.x, size.y, 0,
-                     GL_RGB, GL_FLOAT, nullptr);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyTexture()
-    {
-        glDeleteTextures(1, &self->tex);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createRenderbuffer()
-    {
-        glGenRenderbuffers(1, &rbo);
-        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
-                              size.x, size.y);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyRenderbuffer()
-    {
-        glDeleteRenderbuffers(1, &rbo);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createFramebuffer()
-    {
-        glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glFramebufferTexture2D(GL_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D,
-                               self->tex,
-                               0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                                  GL_DEPTH_ATTACHMENT,
-                                  GL_RENDERBUFFER,
-                                  rbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyFramebuffer()
-    {
-        glDeleteFramebuffers(1, &fbo);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createShader()
-    {
-        pgm = opengl_shader_loader::load(
+        shaders->add(
                 "shaders/sunne_opengl_star_effect_render.vsh",
-                "shaders/sunne_opengl_star_effect_render.fsh");
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void destroyShader()
-    {
-        glDeleteProgram(pgm);
+                "shaders/sunne_opengl_star_effect_render.fsh",
+                [this](GLuint linked) { pgm = linked; });
     }
 
     /* ------------------------------------------------------------ *
@@ -135,60 +57,39 @@ struct OpenGLStarEffectRender::Impl
         ndcQuad.reset();
     }
 
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void resize(const glm::ivec2& newSize)
-    {
-        size = newSize;
-
-        destroyTexture();
-        destroyRenderbuffer();
-        destroyFramebuffer();
-
-        createTexture();
-        createRenderbuffer();
-        createFramebuffer();
-    }
-
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void draw()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-        glViewport(0, 0, size.x, size.y);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // The cleared target until the program has been built.
+        if (pgm == 0)
+            return;
 
-        glUseProgram(pgm);
+        opengl_state::useProgram(pgm);
 
         ndcQuad->draw();
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    glm::ivec2 size;
-    OpenGLStarEffectRender* self;
-    GLuint rbo = 0;
-    GLuint fbo = 0;
     GLuint pgm = 0;
     std::shared_ptr<NdcQuadMesh> ndcQuad;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-OpenGLStarEffectRender::OpenGLStarEffectRender(const glm::ivec2& size)
-    : impl(std::make_shared<Impl>(size, this))
+OpenGLStarEffectRender::OpenGLStarEffectRender(
+        std::shared_ptr<OpenGLShaderManager> shaders)
+    : impl(std::make_shared<Impl>(shaders))
 {}
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-void OpenGLStarEffectRender::resize(const glm::ivec2& size)
-{ impl->resize(size); }
-
 void OpenGLStarEffectRender::draw()
-{ impl->draw(); }
+{
+    SUNNE_PROFILE_ZONE("OpenGLStarEffectRender::draw");
+    impl->draw();
+}
 
 } // namespace sunne
 } // namespace kuu
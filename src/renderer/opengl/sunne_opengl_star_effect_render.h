@@ -14,6 +14,8 @@ namespace kuu
 namespace sunne
 { 
 
+class OpenGLShaderManager;
+
 /* ---------------------------------------------------------------- *
    Renders the sun effects into framebuffer that can be later
    used during composion.
@@ -21,12 +23,10 @@ namespace sunne
 class OpenGLStarEffectRender
 {
 public:
-    OpenGLStarEffectRender(const glm::ivec2& size);
-    void resize(const glm::ivec2& size);
+    OpenGLStarEffectRender(std::shared_ptr<OpenGLShaderManager> shaders);
+    // Draws into the bound framebuffer.
     void draw();
 
-    GLuint tex = 0;
-
 private:
     struct Impl;
     std::shared_ptr<Impl> impl;
@@ -0,0 +1,309 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::opengl_state namespace.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_state.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace opengl_state
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Value that never matches a real name or enum, the state is not
+   known until it has been set once.
+ * ---------------------------------------------------------------- */
+const GLuint Unknown = 0xffffffffu;
+
+const GLuint TextureUnitCount   = 16;
+const GLuint TextureTargetCount = 3;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct State
+{
+    GLuint program      = Unknown;
+    GLuint vertexArray  = Unknown;
+    GLuint drawFbo      = Unknown;
+    GLuint readFbo      = Unknown;
+    GLuint activeUnit   = Unknown;
+    GLuint textures[TextureUnitCount][TextureTargetCount];
+    GLint viewport[4]   = { -1, -1, -1, -1 };
+    GLenum blendSrc     = Unknown;
+    GLenum blendDst     = Unknown;
+    GLenum depthFunc    = Unknown;
+    GLuint blend        = Unknown;
+    GLuint depthTest    = Unknown;
+    GLuint scissorTest  = Unknown;
+    Counters counters;
+
+    State()
+    {
+        for (GLuint unit = 0; unit < TextureUnitCount; ++unit)
+            for (GLuint target = 0; target < TextureTargetCount; ++target)
+                textures[unit][target] = Unknown;
+    }
+};
+
+// Each thread has its own context, the loader thread binds the
+// textures it uploads in the shared context.
+thread_local State state;
+
+/* ---------------------------------------------------------------- *
+   Returns true if the value differs from the tracked value and
+   stores it. Counts the call either way.
+ * ---------------------------------------------------------------- */
+bool changes(GLuint& tracked, GLuint value)
+{
+    if (tracked == value)
+    {
+        state.counters.filtered++;
+        return false;
+    }
+    tracked = value;
+    state.counters.issued++;
+    return true;
+}
+
+/* ---------------------------------------------------------------- *
+   Returns the index of the tracked texture target or -1.
+ * ---------------------------------------------------------------- */
+int textureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D:       return 0;
+        case GL_TEXTURE_3D:       return 1;
+        case GL_TEXTURE_2D_ARRAY: return 2;
+        default:                  return -1;
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint* capability(GLenum cap)
+{
+    switch (cap)
+    {
+        case GL_BLEND:        return &state.blend;
+        case GL_DEPTH_TEST:   return &state.depthTest;
+        case GL_SCISSOR_TEST: return &state.scissorTest;
+        default:              return nullptr;
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void activeTexture(GLuint unit)
+{
+    if (changes(state.activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void useProgram(GLuint pgm)
+{
+    if (changes(state.program, pgm))
+        glUseProgram(pgm);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void bindVertexArray(GLuint vao)
+{
+    if (changes(state.vertexArray, vao))
+        glBindVertexArray(vao);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void bindTexture(GLuint unit, GLenum target, GLuint tex)
+{
+    const int index = textureTargetIndex(target);
+    if (index < 0 || unit >= TextureUnitCount)
+    {
+        activeTexture(unit);
+        glBindTexture(target, tex);
+        state.counters.issued++;
+        return;
+    }
+
+    if (state.textures[unit][index] == tex)
+    {
+        state.counters.filtered++;
+        return;
+    }
+
+    activeTexture(unit);
+    changes(state.textures[unit][index], tex);
+    glBindTexture(target, tex);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void bindFramebuffer(GLenum target, GLuint fbo)
+{
+    if (target == GL_FRAMEBUFFER)
+    {
+        if (state.drawFbo == fbo && state.readFbo == fbo)
+        {
+            state.counters.filtered++;
+            return;
+        }
+        state.drawFbo = fbo;
+        state.readFbo = fbo;
+        state.counters.issued++;
+        glBindFramebuffer(target, fbo);
+        return;
+    }
+
+    GLuint& tracked = target == GL_READ_FRAMEBUFFER ? state.readFbo
+                                                    : state.drawFbo;
+    if (changes(tracked, fbo))
+        glBindFramebuffer(target, fbo);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint* v = state.viewport;
+    if (v[0] == x && v[1] == y && v[2] == width && v[3] == height)
+    {
+        state.counters.filtered++;
+        return;
+    }
+    v[0] = x;
+    v[1] = y;
+    v[2] = width;
+    v[3] = height;
+    state.counters.issued++;
+    glViewport(x, y, width, height);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void blendFunc(GLenum src, GLenum dst)
+{
+    if (state.blendSrc == src && state.blendDst == dst)
+    {
+        state.counters.filtered++;
+        return;
+    }
+    state.blendSrc = src;
+    state.blendDst = dst;
+    state.counters.issued++;
+    glBlendFunc(src, dst);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void depthFunc(GLenum func)
+{
+    if (changes(state.depthFunc, func))
+        glDepthFunc(func);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void enable(GLenum cap)
+{
+    GLuint* tracked = capability(cap);
+    if (!tracked || changes(*tracked, GL_TRUE))
+        glEnable(cap);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void disable(GLenum cap)
+{
+    GLuint* tracked = capability(cap);
+    if (!tracked || changes(*tracked, GL_FALSE))
+        glDisable(cap);
+}
+
+/* ---------------------------------------------------------------- *
+   A deleted program stays in use until an other program is used,
+   the name can be reused only after that. Forgetting it makes sure
+   that a new program with the same name is bound.
+ * ---------------------------------------------------------------- */
+void deleteProgram(GLuint pgm)
+{
+    if (pgm != 0 && state.program == pgm)
+        state.program = Unknown;
+    glDeleteProgram(pgm);
+}
+
+/* ---------------------------------------------------------------- *
+   Deleting a bound object reverts the binding to zero.
+ * ---------------------------------------------------------------- */
+void deleteVertexArrays(GLsizei count, const GLuint* vaos)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        if (vaos[i] != 0 && state.vertexArray == vaos[i])
+            state.vertexArray = 0;
+    glDeleteVertexArrays(count, vaos);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void deleteTextures(GLsizei count, const GLuint* texs)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (texs[i] == 0)
+            continue;
+        for (GLuint unit = 0; unit < TextureUnitCount; ++unit)
+            for (GLuint target = 0; target < TextureTargetCount; ++target)
+                if (state.textures[unit][target] == texs[i])
+                    state.textures[unit][target] = 0;
+    }
+    glDeleteTextures(count, texs);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void deleteFramebuffers(GLsizei count, const GLuint* fbos)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        if (fbos[i] == 0)
+            continue;
+        if (state.drawFbo == fbos[i])
+            state.drawFbo = 0;
+        if (state.readFbo == fbos[i])
+            state.readFbo = 0;
+    }
+    glDeleteFramebuffers(count, fbos);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void invalidate()
+{
+    const Counters counters = state.counters;
+    state = State();
+    state.counters = counters;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Counters counters()
+{ return state.counters; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void resetCounters()
+{ state.counters = Counters(); }
+
+} // namespace opengl_state
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,86 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::opengl_state namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace opengl_state
+{
+
+/* ---------------------------------------------------------------- *
+   Tracks the bound OpenGL objects and the fixed function state of
+   the current context and skips the calls that would not change
+   it. All the OpenGL classes must bind and delete these objects
+   through the functions below, a direct call to OpenGL leaves the
+   tracked state stale. Call invalidate after a third party code has
+   changed the state. The state is tracked per thread as each thread
+   has its own context.
+
+   Texture bindings are tracked for the 2D, 3D and 2D array targets
+   of the first 16 units, other targets are passed through.
+
+   The draws leave their vertex array bound. Bind the vertex array 0
+   before binding an element buffer outside of a vertex array.
+ * ---------------------------------------------------------------- */
+
+void useProgram(GLuint pgm);
+void bindVertexArray(GLuint vao);
+void bindTexture(GLuint unit, GLenum target, GLuint tex);
+void bindFramebuffer(GLenum target, GLuint fbo);
+void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void blendFunc(GLenum src, GLenum dst);
+void depthFunc(GLenum func);
+
+// Enables or disables GL_BLEND, GL_DEPTH_TEST or GL_SCISSOR_TEST.
+void enable(GLenum cap);
+void disable(GLenum cap);
+
+/* ---------------------------------------------------------------- *
+   Texture units of the passes. A pass has its own units so that
+   the bindings of its static textures stay over the frames. The
+   textures are bound into the upload unit for the creation and the
+   updates.
+ * ---------------------------------------------------------------- */
+namespace texture_unit
+{
+const GLuint Planet     = 0;  // 5 units
+const GLuint Satellite  = 5;
+const GLuint Atmosphere = 6;  // 3 units
+const GLuint Compose    = 9;  // 5 units
+const GLuint Loading    = 14;
+const GLuint Upload     = 15;
+} // namespace texture_unit
+
+// Deletes the object and forgets its bindings.
+void deleteProgram(GLuint pgm);
+void deleteVertexArrays(GLsizei count, const GLuint* vaos);
+void deleteTextures(GLsizei count, const GLuint* texs);
+void deleteFramebuffers(GLsizei count, const GLuint* fbos);
+
+// Marks the whole state as unknown, the next call of each kind is
+// issued.
+void invalidate();
+
+/* ---------------------------------------------------------------- *
+   Counts of the state calls since the previous reset.
+ * ---------------------------------------------------------------- */
+struct Counters
+{
+    size_t issued   = 0; // calls passed to OpenGL
+    size_t filtered = 0; // redundant calls skipped
+};
+
+Counters counters();
+void resetCounters();
+
+} // namespace opengl_state
+} // namespace sunne
+} // namespace kuu
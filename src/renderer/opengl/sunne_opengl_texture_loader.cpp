@@ -4,8 +4,37 @@
  * ---------------------------------------------------------------- */
 
 #include "sunne_opengl_texture_loader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include "sunne_opengl_extensions.h"
+#include "sunne_opengl_state.h"
+#include "../../sunne_file_cache.h"
+#include "../../sunne_hash.h"
+#include "../../sunne_mapped_file.h"
+#include "../../sunne_profiler.h"
+
+/* ---------------------------------------------------------------- *
+   The RGTC formats are in the core profile since 3.0 and the BPTC
+   formats since 4.2. The S3TC formats are only in extensions, see
+   supportedFormat.
+ * ---------------------------------------------------------------- */
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
 
 namespace kuu
 {
@@ -13,67 +42,572 @@ namespace sunne
 {
 namespace opengl_texture_loader
 {
+namespace
+{
+
+using texture_compression::Format;
+using opengl_extensions::hasExtension;
+
+/* ---------------------------------------------------------------- *
+   Layout of the cache file:
+
+    1) header
+    2) level table, header.levelCount entries
+    3) pixel data of the levels, tightly packed rows or compressed
+       blocks
+
+   Offsets are from the start of the file. Increase the version when
+   the layout, the downsampling or the encoding changes.
+ * ---------------------------------------------------------------- */
+const char CacheMagic[8] = { 'S', 'U', 'N', 'N', 'E', 'T', 'E', 'X' };
+const uint32_t CacheVersion = 2;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t sRgb;
+    uint32_t compression;
+    uint32_t levelCount;
+};
+
+struct CacheLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+/* ---------------------------------------------------------------- *
+   Serializes the OpenMP stages of the concurrent decodes. Each
+   stage uses all the cores, several teams at once would start a
+   multiple of the core count in threads. The single threaded image
+   decode still runs concurrently.
+ * ---------------------------------------------------------------- */
+std::mutex parallelStageMutex;
+
+/* ---------------------------------------------------------------- *
+   sRGB <-> linear conversions, see the sRGB specification.
+ * ---------------------------------------------------------------- */
+float srgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f
+                         : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f
+                           : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+/* ---------------------------------------------------------------- *
+   Downsamples the level into the half size with a box filter. Color
+   channels of sRGB images are averaged in linear space, alpha is
+   always linear.
+ * ---------------------------------------------------------------- */
+void downsample(const unsigned char* src, int srcW, int srcH,
+                unsigned char* dst, int dstW, int dstH,
+                int channels, bool sRgb)
+{
+    static float toLinear[256];
+    static const bool toLinearInit = []()
+    {
+        for (int i = 0; i < 256; ++i)
+            toLinear[i] = srgbToLinear(i / 255.0f);
+        return true;
+    }();
+    (void) toLinearInit;
+
+    const int colorChannels = sRgb ? std::min(channels, 3) : 0;
+
+    #pragma omp parallel for
+    for (int y = 0; y < dstH; ++y)
+    {
+        const int y0 = std::min(y * 2,     srcH - 1);
+        const int y1 = std::min(y * 2 + 1, srcH - 1);
+        for (int x = 0; x < dstW; ++x)
+        {
+            const int x0 = std::min(x * 2,     srcW - 1);
+            const int x1 = std::min(x * 2 + 1, srcW - 1);
+
+            const unsigned char* p[4] =
+            {
+                src + (size_t(y0) * srcW + x0) * channels,
+                src + (size_t(y0) * srcW + x1) * channels,
+                src + (size_t(y1) * srcW + x0) * channels,
+                src + (size_t(y1) * srcW + x1) * channels,
+            };
+
+            unsigned char* out = dst + (size_t(y) * dstW + x) * channels;
+            for (int c = 0; c < channels; ++c)
+            {
+                float v;
+                if (c < colorChannels)
+                {
+                    v = (toLinear[p[0][c]] + toLinear[p[1][c]] +
+                         toLinear[p[2][c]] + toLinear[p[3][c]]) * 0.25f;
+                    v = linearToSrgb(v);
+                }
+                else
+                {
+                    v = (p[0][c] + p[1][c] + p[2][c] + p[3][c]) / (4.0f * 255.0f);
+                }
+                out[c] = static_cast<unsigned char>(
+                    std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Sets the levels of the image to point into the data. The data
+   starts from the given offset of the cache file layout.
+ * ---------------------------------------------------------------- */
+void setLevels(Image& image,
+               const unsigned char* data,
+               uint64_t dataOffset,
+               const std::vector<CacheLevel>& levels)
+{
+    image.levels.clear();
+    for (const CacheLevel& l : levels)
+    {
+        Image::Level level;
+        level.width  = int(l.width);
+        level.height = int(l.height);
+        level.size   = size_t(l.size);
+        level.pixels = data + (l.offset - dataOffset);
+        image.levels.push_back(level);
+    }
+}
 
 /* ---------------------------------------------------------------- *
+   Returns the size of the level in bytes.
  * ---------------------------------------------------------------- */
-GLuint load(const std::string& path, int req_comp, bool sRgb)
+uint64_t levelSize(Format compression, uint32_t width, uint32_t height,
+                   uint32_t channels)
 {
+    if (compression == Format::None)
+        return uint64_t(width) * height * channels;
+    return texture_compression::compressedSize(compression,
+                                               int(width),
+                                               int(height));
+}
+
+/* ---------------------------------------------------------------- *
+   Lays out the levels after the header and the level table. Returns
+   the end offset of the last level.
+ * ---------------------------------------------------------------- */
+uint64_t layoutLevels(std::vector<CacheLevel>& levels)
+{
+    uint64_t offset = sizeof(CacheHeader) + levels.size() * sizeof(CacheLevel);
+    for (CacheLevel& l : levels)
+    {
+        l.offset = offset;
+        offset += l.size;
+    }
+    return offset;
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the image into the cache file. The data contains the
+   levels starting from the first level offset.
+ * ---------------------------------------------------------------- */
+void writeCache(const std::string& cachePath,
+                const Image& image,
+                const std::vector<CacheLevel>& levels,
+                const std::vector<unsigned char>& data)
+{
+    CacheHeader header;
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version     = CacheVersion;
+    header.width       = uint32_t(image.width);
+    header.height      = uint32_t(image.height);
+    header.channels    = uint32_t(image.channels);
+    header.sRgb        = image.sRgb ? 1 : 0;
+    header.compression = uint32_t(image.compression);
+    header.levelCount  = uint32_t(levels.size());
+
+    file_cache::write(cachePath,
+    {
+        { &header,       sizeof(CacheHeader) },
+        { levels.data(), levels.size() * sizeof(CacheLevel) },
+        { data.data(),   data.size() }
+    });
+}
+
+/* ---------------------------------------------------------------- *
+   Reads the image from the cache file. Returns false if the file
+   does not exist or it does not match with the request.
+ * ---------------------------------------------------------------- */
+bool readCache(const std::string& cachePath, int req_comp, Image& image)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::readCache");
+
+    auto file = std::make_shared<MappedFile>(cachePath);
+    if (!file->isOpen() || file->size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(CacheHeader));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        header.version != CacheVersion ||
+        header.levelCount == 0 ||
+        bool(header.sRgb) != image.sRgb ||
+        header.compression != uint32_t(image.compression) ||
+        (req_comp != 0 && int(header.channels) != req_comp))
+    {
+        return false;
+    }
+
+    const size_t tableEnd = sizeof(CacheHeader) +
+                            header.levelCount * sizeof(CacheLevel);
+    if (file->size() < tableEnd)
+        return false;
+
+    std::vector<CacheLevel> levels(header.levelCount);
+    std::memcpy(levels.data(),
+                file->data() + sizeof(CacheHeader),
+                levels.size() * sizeof(CacheLevel));
+
+    for (const CacheLevel& l : levels)
+    {
+        const uint64_t size = levelSize(image.compression,
+                                        l.width, l.height,
+                                        header.channels);
+        if (l.size != size || l.offset < tableEnd ||
+            l.offset + l.size > file->size())
+            return false;
+    }
+
+    image.width    = int(header.width);
+    image.height   = int(header.height);
+    image.channels = int(header.channels);
+    image.storage  = file;
+    setLevels(image, file->data(), 0, levels);
+    return true;
+}
+
+/* ---------------------------------------------------------------- *
+   Decodes the image with stb, builds the mip chain and writes the
+   result into the cache file.
+ * ---------------------------------------------------------------- */
+void decodeSource(const MappedFile& source,
+                  const std::string& cachePath,
+                  int req_comp,
+                  Image& image)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::decodeSource");
+
     int imgW, imgH, imgC;
-    stbi_uc* pixels = stbi_load(
-        path.c_str(),
+    stbi_uc* pixels = stbi_load_from_memory(
+        source.data(),
+        int(source.size()),
         &imgW,
         &imgH,
         &imgC,
         req_comp);
 
     if (!pixels)
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+                ": failed to load image " +
+                image.path);
+
+    // Pixels have the requested count of channels, imgC is the
+    // count in the file.
+    const int channels = req_comp != 0 ? req_comp : imgC;
+
+    std::vector<CacheLevel> levels;
+    int w = imgW, h = imgH;
+    for (;;)
+    {
+        levels.push_back({ uint32_t(w), uint32_t(h), 0, uint64_t(w) * h * channels });
+        if (w == 1 && h == 1)
+            break;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    const uint64_t offset = layoutLevels(levels);
+
+    const size_t dataStart = size_t(levels.front().offset);
+    auto data = std::make_shared<std::vector<unsigned char>>(size_t(offset) - dataStart);
+    std::memcpy(data->data(), pixels, size_t(levels.front().size));
+    stbi_image_free(pixels);
+
+    std::unique_lock<std::mutex> lock(parallelStageMutex);
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        const CacheLevel& src = levels[i - 1];
+        const CacheLevel& dst = levels[i];
+        downsample(data->data() + (src.offset - dataStart),
+                   int(src.width), int(src.height),
+                   data->data() + (dst.offset - dataStart),
+                   int(dst.width), int(dst.height),
+                   channels, image.sRgb);
+    }
+    lock.unlock();
+
+    image.width    = imgW;
+    image.height   = imgH;
+    image.channels = channels;
+    image.storage  = data;
+    setLevels(image, data->data(), dataStart, levels);
+    writeCache(cachePath, image, levels, *data);
+}
+
+/* ---------------------------------------------------------------- *
+   Encodes the levels of the uncompressed source image into the
+   compression format of the image and writes the result into the
+   cache file.
+ * ---------------------------------------------------------------- */
+void compress(const Image& source,
+              const std::string& cachePath,
+              Image& image)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::compress");
+
+    std::vector<CacheLevel> levels;
+    for (const Image::Level& l : source.levels)
+    {
+        levels.push_back({ uint32_t(l.width), uint32_t(l.height), 0,
+                           levelSize(image.compression,
+                                     uint32_t(l.width),
+                                     uint32_t(l.height),
+                                     uint32_t(source.channels)) });
+    }
+    const uint64_t offset = layoutLevels(levels);
+
+    const size_t dataStart = size_t(levels.front().offset);
+    auto data = std::make_shared<std::vector<unsigned char>>(size_t(offset) - dataStart);
+    std::unique_lock<std::mutex> lock(parallelStageMutex);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const Image::Level& l = source.levels[i];
+        texture_compression::encode(image.compression,
+                                    l.pixels,
+                                    l.width,
+                                    l.height,
+                                    source.channels,
+                                    data->data() + (levels[i].offset - dataStart));
+    }
+    lock.unlock();
+
+    image.width    = source.width;
+    image.height   = source.height;
+    image.channels = source.channels;
+    image.storage  = data;
+    setLevels(image, data->data(), dataStart, levels);
+    writeCache(cachePath, image, levels, *data);
+}
+
+/* ---------------------------------------------------------------- *
+   Sets the mip level range and the sampling parameters of the bound
+   texture.
+ * ---------------------------------------------------------------- */
+void setParameters(const Image& image)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  GLint(image.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_REPEAT);
+    if (GL_TEXTURE_MAX_ANISOTROPY_EXT)
+    {
+        GLfloat anisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Returns the OpenGL internal format of the compressed image.
+ * ---------------------------------------------------------------- */
+GLenum compressedFormat(const Image& image)
+{
+    switch (image.compression)
+    {
+        case Format::BC1:
+            return image.sRgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+                              : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case Format::BC3:
+            return image.sRgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                              : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case Format::BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case Format::BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case Format::BC7:
+            return image.sRgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                              : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case Format::None:
+            break;
+    }
+
+    throw std::runtime_error(
+        std::string(__FUNCTION__) +
+            ": image " + image.path + " is not compressed");
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+texture_compression::Format supportedFormat(
+    texture_compression::Format compression,
+    bool sRgb)
+{
+    bool supported = true;
+    switch (compression)
+    {
+        case Format::BC1:
+        case Format::BC3:
+            supported = hasExtension("GL_EXT_texture_compression_s3tc") &&
+                        (!sRgb || hasExtension("GL_EXT_texture_sRGB") ||
+                                  hasExtension("GL_EXT_texture_compression_s3tc_srgb"));
+            break;
+        case Format::BC7:
+            supported = GLAD_GL_VERSION_4_2 ||
+                        hasExtension("GL_ARB_texture_compression_bptc");
+            break;
+        case Format::BC4:
+        case Format::BC5:
+        case Format::None:
+            break;
+    }
+    return supported ? compression : Format::None;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Image decode(const std::string& path,
+             int req_comp,
+             bool sRgb,
+             texture_compression::Format compression)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::decode");
+
+    Image image;
+    image.path = path;
+    image.sRgb = sRgb;
+
+    MappedFile source(path);
+    if (!source.isOpen())
         throw std::runtime_error(
             std::string(__FUNCTION__) +
                 ": failed to load image " +
                 path);
 
+    uint64_t key = hash::fnv1a(source.data(), source.size());
+    key = hash::fnv1a(path, key);
+    key = hash::fnv1a(&req_comp, sizeof(req_comp), key);
+    key = hash::fnv1a(&sRgb, sizeof(sRgb), key);
+
+    // The compressed image is cached separately from the decoded
+    // image, the decoded image is needed only when encoding.
+    Image compressed;
+    std::string compressedPath;
+    if (compression != Format::None)
+    {
+        compressed.path        = path;
+        compressed.sRgb        = sRgb;
+        compressed.compression = compression;
+
+        const uint64_t compressedKey =
+            hash::fnv1a(&compression, sizeof(compression), key);
+        compressedPath = file_cache::path("textures", compressedKey, ".tex");
+        if (readCache(compressedPath, req_comp, compressed))
+            return compressed;
+    }
+
+    const std::string cachePath = file_cache::path("textures", key, ".tex");
+    if (!readCache(cachePath, req_comp, image))
+        decodeSource(source, cachePath, req_comp, image);
+
+    if (compression == Format::None)
+        return image;
+
+    compress(image, compressedPath, compressed);
+    return compressed;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint upload(const Image& image)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::upload");
+
+    if (image.compression != Format::None)
+    {
+        const GLenum internalFormat = compressedFormat(image);
+
+        GLuint tex;
+        glGenTextures(1, &tex);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, tex);
+        for (size_t i = 0; i < image.levels.size(); ++i)
+        {
+            const Image::Level& level = image.levels[i];
+            glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), internalFormat,
+                                   level.width, level.height, 0,
+                                   GLsizei(level.size), level.pixels);
+        }
+        setParameters(image);
+        opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, 0);
+        return tex;
+    }
+
     GLenum format, internalFormat;
-    switch(imgC)
+    switch(image.channels)
     {
         case 1: internalFormat = format = GL_RED;  break;
         case 2: internalFormat = format = GL_RG;   break;
-        case 3: format = GL_RGB;  internalFormat = sRgb ? GL_SRGB       : GL_RGB;  break;
-        case 4: format = GL_RGBA; internalFormat = sRgb ? GL_SRGB_ALPHA : GL_RGBA; break;
+        case 3: format = GL_RGB;  internalFormat = image.sRgb ? GL_SRGB       : GL_RGB;  break;
+        case 4: format = GL_RGBA; internalFormat = image.sRgb ? GL_SRGB_ALPHA : GL_RGBA; break;
         default:
             throw std::runtime_error(
                 std::string(__FUNCTION__) +
                     ": failed to load texture " +
-                    path +
+                    image.path +
                     " as it has invalid channel count of " +
-                    std::to_string(imgC));
+                    std::to_string(image.channels));
     }
 
     GLuint tex;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D,  tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GLint(internalFormat),
-                 imgW, imgH, 0,
-                 format, GL_UNSIGNED_BYTE, pixels);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_REPEAT);
-    if (GL_TEXTURE_MAX_ANISOTROPY_EXT)
+    opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < image.levels.size(); ++i)
     {
-        GLfloat anisotropy = 1.0f;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+        const Image::Level& level = image.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, GLint(i), GLint(internalFormat),
+                     level.width, level.height, 0,
+                     format, GL_UNSIGNED_BYTE, level.pixels);
     }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D,  0);
-
-    delete[] pixels;
+    setParameters(image);
+    opengl_state::bindTexture(opengl_state::texture_unit::Upload, GL_TEXTURE_2D, 0);
 
     return tex;
 }
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+GLuint load(const std::string& path,
+            int req_comp,
+            bool sRgb,
+            texture_compression::Format compression)
+{
+    SUNNE_PROFILE_ZONE("opengl_texture_loader::load");
+    return upload(decode(path, req_comp, sRgb,
+                         supportedFormat(compression, sRgb)));
+}
+
 } // namespace opengl_texture_loader
 } // namespace sunne
 } // namespace kuu
@@ -7,7 +7,9 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <glad/glad.h>
+#include "../sunne_texture_compression.h"
 
 namespace kuu
 {
@@ -17,8 +19,79 @@ namespace opengl_texture_loader
 {
 
 /* ---------------------------------------------------------------- *
+   A decoded image with the full mip chain, 8-bits per channel or
+   block compressed. Level 0 is the image itself. The storage owns
+   the pixel memory, it is either a decoded buffer or a memory
+   mapped cache file.
  * ---------------------------------------------------------------- */
-GLuint load(const std::string& path, int req_comp, bool sRgb);
+struct Image
+{
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        size_t size = 0; // bytes
+        const unsigned char* pixels = nullptr;
+    };
+
+    std::string path;
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    bool sRgb    = false;
+    texture_compression::Format compression = texture_compression::Format::None;
+    std::vector<Level> levels;
+    std::shared_ptr<const void> storage;
+};
+
+/* ---------------------------------------------------------------- *
+   Returns the compression format if the current context can sample
+   it, otherwise Format::None and the image is uploaded uncompressed.
+   The S3TC and BPTC formats need an extension on a 3.3 context. Must
+   be called from a thread that has a current OpenGL context.
+ * ---------------------------------------------------------------- */
+texture_compression::Format supportedFormat(
+    texture_compression::Format compression,
+    bool sRgb);
+
+/* ---------------------------------------------------------------- *
+   Decodes the image from the file. If req_comp is not zero then the
+   image is converted to have the given count of channels. Mip levels
+   of sRGB image are downsampled in linear space.
+
+   If the compression is set then each level is encoded into the
+   compression format. Encoding is slow, it is done only once as the
+   result is cached.
+
+   Decoded images are cached on disk with the key of the path and
+   the file content. On a cache hit the cache file is memory mapped
+   and nothing is decoded. Does not call OpenGL, can be called from
+   any thread. The downsampling and the encoding use all the cores
+   with OpenMP, of the concurrent decodes only one runs them at a
+   time.
+ * ---------------------------------------------------------------- */
+Image decode(const std::string& path,
+             int req_comp,
+             bool sRgb,
+             texture_compression::Format compression =
+                texture_compression::Format::None);
+
+/* ---------------------------------------------------------------- *
+   Uploads the image and its mip levels into a texture, compressed
+   image is uploaded as is in the compressed format. Must be
+   called from a thread that has a current OpenGL context.
+ * ---------------------------------------------------------------- */
+GLuint upload(const Image& image);
+
+/* ---------------------------------------------------------------- *
+   Decodes and uploads the image. An unsupported compression format
+   falls back to the uncompressed image.
+ * ---------------------------------------------------------------- */
+GLuint load(const std::string& path,
+            int req_comp,
+            bool sRgb,
+            texture_compression::Format compression =
+                texture_compression::Format::None);
 
 } // namespace opengl_texture_loader
 } // namespace sunne
@@ -0,0 +1,147 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLTimerQuery class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_timer_query.h"
+#include <vector>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLTimerQuery::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const std::string& name, int averageFrameCount)
+        : name(name)
+        , samples(size_t(averageFrameCount), 0.0)
+    {
+        glGenQueries(2, queries);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        glDeleteQueries(2, queries);
+    }
+
+    /* ------------------------------------------------------------ *
+       Reads the result of the query if it is available.
+     * ------------------------------------------------------------ */
+    void read(int index)
+    {
+        if (!pending[index])
+            return;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[index],
+                           GL_QUERY_RESULT_AVAILABLE,
+                           &available);
+        if (!available)
+            return;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &ns);
+        pending[index] = false;
+
+        samples[sampleIndex] = double(ns) / 1.0e6;
+        sampleIndex = (sampleIndex + 1) % samples.size();
+        if (sampleCount < samples.size())
+            sampleCount++;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void begin()
+    {
+        // Result of the previous frame.
+        read(1 - current);
+
+        // If the older result is still not available then it is
+        // dropped, the query object is reused.
+        read(current);
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void end()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        current = 1 - current;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    double average() const
+    {
+        if (sampleCount == 0)
+            return 0.0;
+
+        double sum = 0.0;
+        for (size_t i = 0; i < sampleCount; ++i)
+            sum += samples[i];
+        return sum / double(sampleCount);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    double latest() const
+    {
+        if (sampleCount == 0)
+            return 0.0;
+        return samples[(sampleIndex + samples.size() - 1) % samples.size()];
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    std::string name;
+    GLuint queries[2];
+    bool pending[2] = { false, false };
+    int current = 0;
+    std::vector<double> samples;
+    size_t sampleIndex = 0;
+    size_t sampleCount = 0;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLTimerQuery::OpenGLTimerQuery(const std::string& name,
+                                   int averageFrameCount)
+    : impl(std::make_shared<Impl>(name, averageFrameCount))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLTimerQuery::begin()
+{ impl->begin(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLTimerQuery::end()
+{ impl->end(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::string OpenGLTimerQuery::name() const
+{ return impl->name; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+double OpenGLTimerQuery::average() const
+{ return impl->average(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+double OpenGLTimerQuery::latest() const
+{ return impl->latest(); }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,48 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLTimerQuery class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Measures the GPU time between begin and end with double-buffered
+   GL_TIME_ELAPSED queries. The result of the previous frame is read
+   only if it is available so the pipeline is never stalled. The
+   time is a rolling average over the last frames.
+
+   Timer queries can not be nested, only one query can be active at
+   a time.
+ * ---------------------------------------------------------------- */
+class OpenGLTimerQuery
+{
+public:
+    OpenGLTimerQuery(const std::string& name,
+                     int averageFrameCount = 60);
+
+    void begin();
+    void end();
+
+    // Returns the name of the measured pass.
+    std::string name() const;
+    // Returns the average time in milliseconds.
+    double average() const;
+    // Returns the time of the latest measured frame in milliseconds.
+    double latest() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
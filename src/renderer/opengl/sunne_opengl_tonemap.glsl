@@ -0,0 +1,14 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Tone mapping of the passes that write into the window.
+ * ---------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------- *
+   Maps the radiance into the display range with an exponential
+   curve and applies the display gamma.
+ * ---------------------------------------------------------------- */
+vec3 tonemap(vec3 color, float exposure)
+{
+    color = 1.0 - exp(-exposure * color);
+    return pow(color, vec3(1.0 / 2.2));
+}
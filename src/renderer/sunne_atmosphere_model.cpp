@@ -0,0 +1,780 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::AtmosphereModel class.
+
+   The functions follow sunne_opengl_atmosphere_model.glsl and the
+   atmosphere shaders, see them for the parametrization.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_atmosphere_model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include "sunne_float_pack.h"
+#include "../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+using Pack = NativeFloatPack;
+using Atmosphere = RendererScene::Atmosphere;
+
+const int OpticalDepthSampleCount  = 500;
+const int ScatteringSampleCount    = 64;
+const int ReferenceSampleCount     = 128;
+const int ReferenceLightSampleCount = 32;
+const int TileSize                 = 32;
+const int ScatteringNuSize         = 8;
+const int ScatteringMuSSize        = 32;
+const int ScatteringMuSize         = 128;
+const int ScatteringRSize          = 32;
+const float Pi                     = 3.14159265359f;
+
+/* ---------------------------------------------------------------- *
+   Scalar overloads so that the model functions below can be used
+   with a float or with a pack.
+ * ---------------------------------------------------------------- */
+inline float min(float a, float b)   { return std::min(a, b); }
+inline float max(float a, float b)   { return std::max(a, b); }
+inline float sqrt(float a)           { return std::sqrt(a); }
+inline float exp(float a)            { return std::exp(a); }
+inline float clamp(float x, float lo, float hi) { return std::min(std::max(x, lo), hi); }
+inline float select(bool m, float a, float b)   { return m ? a : b; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<typename T>
+void particleDensity(const Atmosphere& a, const T& r, T& rayleigh, T& mie)
+{
+    const T h = max(r - T(a.planetRadius), T(0.0f));
+    rayleigh = exp(-h * T(1.0f / a.rayleighScaleHeight));
+    mie      = exp(-h * T(1.0f / a.mieScaleHeight));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<typename T>
+T distanceToTop(const Atmosphere& a, const T& r, const T& mu)
+{
+    const T discriminant = r * r * (mu * mu - T(1.0f)) + T(a.radius * a.radius);
+    return max(-r * mu + sqrt(max(discriminant, T(0.0f))), T(0.0f));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<typename T>
+T distanceToBottom(const Atmosphere& a, const T& r, const T& mu)
+{
+    const float bottom = a.planetRadius;
+    const T discriminant = r * r * (mu * mu - T(1.0f)) + T(bottom * bottom);
+    return max(-r * mu - sqrt(max(discriminant, T(0.0f))), T(0.0f));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<typename T>
+T rayIntersectsGround(const Atmosphere& a, const T& r, const T& mu)
+{
+    const float bottom = a.planetRadius;
+    return (mu < T(0.0f)) & (r * r * (mu * mu - T(1.0f)) + T(bottom * bottom) >= T(0.0f));
+}
+
+/* ---------------------------------------------------------------- *
+   Rayleigh and Mie optical depth from the radius to the top of
+   atmosphere, integrated with the trapezoidal rule.
+ * ---------------------------------------------------------------- */
+template<typename T>
+void opticalDepth(const Atmosphere& a, const T& r, const T& mu, int sampleCount,
+                  T& rayleigh, T& mie)
+{
+    const T dx = distanceToTop(a, r, mu) * T(1.0f / float(sampleCount));
+    rayleigh = T(0.0f);
+    mie      = T(0.0f);
+    for (int i = 0; i <= sampleCount; ++i)
+    {
+        const T t = T(float(i)) * dx;
+        const T rt = sqrt(t * t + T(2.0f) * r * mu * t + r * r);
+        const float weight = i == 0 || i == sampleCount ? 0.5f : 1.0f;
+        T densityRayleigh, densityMie;
+        particleDensity(a, rt, densityRayleigh, densityMie);
+        rayleigh = rayleigh + densityRayleigh * dx * T(weight);
+        mie      = mie      + densityMie      * dx * T(weight);
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Integrates the single scattering along the rays, see
+   sunne_opengl_atmosphere_scattering.fsh. The light depth returns
+   the Rayleigh optical depth towards the sun.
+ * ---------------------------------------------------------------- */
+template<typename LightDepth>
+void singleScattering(const Atmosphere& a,
+                      const Pack& r, const Pack& mu, const Pack& muS,
+                      const Pack& nu, const Pack& ground,
+                      int sampleCount,
+                      LightDepth lightDepth,
+                      Pack rayleigh[3], Pack& mie)
+{
+    const Pack d = select(ground, distanceToBottom(a, r, mu),
+                                  distanceToTop(a, r, mu));
+    const Pack dx = d * Pack(1.0f / float(sampleCount));
+
+    Pack depthViewRayleigh(0.0f);
+    Pack depthViewMie(0.0f);
+    for (int c = 0; c < 3; ++c)
+        rayleigh[c] = Pack(0.0f);
+    mie = Pack(0.0f);
+
+    for (int i = 0; i < sampleCount; ++i)
+    {
+        const Pack t = Pack(float(i) + 0.5f) * dx;
+        const Pack rt = clamp(sqrt(t * t + Pack(2.0f) * r * mu * t + r * r),
+                              Pack(a.planetRadius), Pack(a.radius));
+        const Pack muSt = clamp((r * muS + t * nu) / rt, Pack(-1.0f), Pack(1.0f));
+
+        Pack densityRayleigh, densityMie;
+        particleDensity(a, rt, densityRayleigh, densityMie);
+        const Pack depthToSampleRayleigh = depthViewRayleigh + densityRayleigh * dx * Pack(0.5f);
+        const Pack depthToSampleMie      = depthViewMie      + densityMie      * dx * Pack(0.5f);
+        depthViewRayleigh = depthViewRayleigh + densityRayleigh * dx;
+        depthViewMie      = depthViewMie      + densityMie      * dx;
+
+        const Pack lit = !rayIntersectsGround(a, rt, muSt);
+        if (!any(lit))
+            continue;
+
+        const Pack depthLight = lightDepth(rt, muSt);
+        for (int c = 0; c < 3; ++c)
+        {
+            const Pack beta(a.rayleighScattering[c]);
+            rayleigh[c] = rayleigh[c] + select(lit,
+                exp(-beta * (depthToSampleRayleigh + depthLight)) * densityRayleigh * dx,
+                Pack(0.0f));
+        }
+        mie = mie + select(lit,
+            exp(-Pack(a.mieScattering) * (depthToSampleMie + depthLight)) * densityMie * dx,
+            Pack(0.0f));
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Table parametrization, scalar.
+ * ---------------------------------------------------------------- */
+float texCoordFromUnitRange(float x, int size)
+{ return 0.5f / float(size) + x * (1.0f - 1.0f / float(size)); }
+
+float unitRangeFromTexCoord(float u, int size)
+{ return (u - 0.5f / float(size)) / (1.0f - 1.0f / float(size)); }
+
+float horizonDistance(const Atmosphere& a)
+{ return std::sqrt(a.radius * a.radius - a.planetRadius * a.planetRadius); }
+
+float muSMin(const Atmosphere& a)
+{
+    const float ratio = a.planetRadius / a.radius;
+    return -std::sqrt(1.0f - ratio * ratio);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+glm::vec2 opticalDepthUv(const Atmosphere& a, const glm::ivec2& size, float r, float mu)
+{
+    const float H = horizonDistance(a);
+    const float bottom = a.planetRadius;
+    const float rho = std::sqrt(std::max(r * r - bottom * bottom, 0.0f));
+    const float d = distanceToTop(a, r, mu);
+    const float dMin = a.radius - r;
+    const float dMax = rho + H;
+    return glm::vec2(texCoordFromUnitRange((d - dMin) / (dMax - dMin), size.x),
+                     texCoordFromUnitRange(rho / H, size.y));
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void opticalDepthRMu(const Atmosphere& a, const glm::ivec2& size,
+                     const glm::vec2& uv, float& r, float& mu)
+{
+    const float H = horizonDistance(a);
+    const float bottom = a.planetRadius;
+    const float xMu = unitRangeFromTexCoord(uv.x, size.x);
+    const float xR  = unitRangeFromTexCoord(uv.y, size.y);
+    const float rho = H * xR;
+    r = std::sqrt(rho * rho + bottom * bottom);
+    const float dMin = a.radius - r;
+    const float dMax = rho + H;
+    const float d = dMin + xMu * (dMax - dMin);
+    mu = d == 0.0f ? 1.0f : clamp((H * H - rho * rho - d * d) / (2.0f * r * d), -1.0f, 1.0f);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+glm::vec4 scatteringUvwz(const Atmosphere& a, float r, float mu, float muS, float nu, bool ground)
+{
+    const float H = horizonDistance(a);
+    const float top = a.radius;
+    const float bottom = a.planetRadius;
+    const float rho = std::sqrt(std::max(r * r - bottom * bottom, 0.0f));
+    const float uR = texCoordFromUnitRange(rho / H, ScatteringRSize);
+
+    const float rMu = r * mu;
+    const float discriminant = rMu * rMu - r * r + bottom * bottom;
+    float uMu;
+    if (ground)
+    {
+        const float d = -rMu - std::sqrt(std::max(discriminant, 0.0f));
+        const float dMin = r - bottom;
+        const float dMax = rho;
+        const float x = dMax == dMin ? 0.0f : (d - dMin) / (dMax - dMin);
+        uMu = 0.5f - 0.5f * texCoordFromUnitRange(x, ScatteringMuSize / 2);
+    }
+    else
+    {
+        const float d = -rMu + std::sqrt(std::max(discriminant + H * H, 0.0f));
+        const float dMin = top - r;
+        const float dMax = rho + H;
+        uMu = 0.5f + 0.5f * texCoordFromUnitRange((d - dMin) / (dMax - dMin),
+                                                  ScatteringMuSize / 2);
+    }
+
+    const float d = distanceToTop(a, bottom, muS);
+    const float dMin = top - bottom;
+    const float dMax = H;
+    const float x = (d - dMin) / (dMax - dMin);
+    const float A = (distanceToTop(a, bottom, muSMin(a)) - dMin) / (dMax - dMin);
+    const float uMuS = texCoordFromUnitRange(std::max(1.0f - x / A, 0.0f) / (1.0f + x),
+                                             ScatteringMuSSize);
+    const float uNu = (nu + 1.0f) / 2.0f;
+    return glm::vec4(uNu, uMuS, uMu, uR);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void scatteringRMuMuSNu(const Atmosphere& a, const glm::vec4& uvwz,
+                        float& r, float& mu, float& muS, float& nu, bool& ground)
+{
+    const float H = horizonDistance(a);
+    const float top = a.radius;
+    const float bottom = a.planetRadius;
+    const float rho = H * unitRangeFromTexCoord(uvwz.w, ScatteringRSize);
+    r = std::sqrt(rho * rho + bottom * bottom);
+
+    if (uvwz.z < 0.5f)
+    {
+        const float dMin = r - bottom;
+        const float dMax = rho;
+        const float d = dMin + (dMax - dMin) *
+            unitRangeFromTexCoord(1.0f - 2.0f * uvwz.z, ScatteringMuSize / 2);
+        mu = d == 0.0f ? -1.0f : clamp(-(rho * rho + d * d) / (2.0f * r * d), -1.0f, 1.0f);
+        ground = true;
+    }
+    else
+    {
+        const float dMin = top - r;
+        const float dMax = rho + H;
+        const float d = dMin + (dMax - dMin) *
+            unitRangeFromTexCoord(2.0f * uvwz.z - 1.0f, ScatteringMuSize / 2);
+        mu = d == 0.0f ? 1.0f : clamp((H * H - rho * rho - d * d) / (2.0f * r * d), -1.0f, 1.0f);
+        ground = false;
+    }
+
+    const float xMuS = unitRangeFromTexCoord(uvwz.y, ScatteringMuSSize);
+    const float dMin = top - bottom;
+    const float dMax = H;
+    const float A = (distanceToTop(a, bottom, muSMin(a)) - dMin) / (dMax - dMin);
+    const float x = (A - xMuS * A) / (1.0f + xMuS * A);
+    const float d = dMin + std::min(x, A) * (dMax - dMin);
+    muS = d == 0.0f ? 1.0f : clamp((H * H - d * d) / (2.0f * bottom * d), -1.0f, 1.0f);
+    nu = clamp(uvwz.x * 2.0f - 1.0f, -1.0f, 1.0f);
+}
+
+/* ---------------------------------------------------------------- *
+   Linear filtering of a texel coordinate with the clamp to edge
+   wrapping. Returns the texels and the weight of the second one.
+ * ---------------------------------------------------------------- */
+void linearTexels(float u, int size, int& i0, int& i1, float& weight)
+{
+    const float x = u * float(size) - 0.5f;
+    const float x0 = std::floor(x);
+    weight = x - x0;
+    i0 = std::min(std::max(int(x0),     0), size - 1);
+    i1 = std::min(std::max(int(x0) + 1, 0), size - 1);
+}
+
+/* ---------------------------------------------------------------- *
+   Linearly filtered lookup of a RG table.
+ * ---------------------------------------------------------------- */
+glm::vec2 sample2D(const std::vector<float>& table, const glm::ivec2& size,
+                   const glm::vec2& uv)
+{
+    int x0, x1, y0, y1;
+    float wx, wy;
+    linearTexels(uv.x, size.x, x0, x1, wx);
+    linearTexels(uv.y, size.y, y0, y1, wy);
+    auto texel = [&](int x, int y)
+    {
+        const float* p = &table[size_t(y * size.x + x) * 2];
+        return glm::vec2(p[0], p[1]);
+    };
+    return glm::mix(glm::mix(texel(x0, y0), texel(x1, y0), wx),
+                    glm::mix(texel(x0, y1), texel(x1, y1), wx), wy);
+}
+
+/* ---------------------------------------------------------------- *
+   Linearly filtered lookup of a RGBA 3D table.
+ * ---------------------------------------------------------------- */
+glm::vec4 sample3D(const std::vector<float>& table, const glm::ivec3& size,
+                   const glm::vec3& uvw)
+{
+    int x0, x1, y0, y1, z0, z1;
+    float wx, wy, wz;
+    linearTexels(uvw.x, size.x, x0, x1, wx);
+    linearTexels(uvw.y, size.y, y0, y1, wy);
+    linearTexels(uvw.z, size.z, z0, z1, wz);
+    auto texel = [&](int x, int y, int z)
+    {
+        const float* p = &table[(size_t(z * size.y + y) * size.x + x) * 4];
+        return glm::vec4(p[0], p[1], p[2], p[3]);
+    };
+    auto row = [&](int y, int z)
+    { return glm::mix(texel(x0, y, z), texel(x1, y, z), wx); };
+    return glm::mix(glm::mix(row(y0, z0), row(y1, z0), wy),
+                    glm::mix(row(y0, z1), row(y1, z1), wy), wz);
+}
+
+/* ---------------------------------------------------------------- *
+   True if the lane of the mask is set.
+ * ---------------------------------------------------------------- */
+bool lane(const Pack& mask, int i)
+{
+    const float f = mask[i];
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits != 0;
+}
+
+/* ---------------------------------------------------------------- *
+   Pack from the lane values.
+ * ---------------------------------------------------------------- */
+template<typename F>
+Pack packLanes(F f)
+{
+    float lanes[Pack::width];
+    for (int i = 0; i < Pack::width; ++i)
+        lanes[i] = f(i);
+    return Pack::load(lanes);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Pack packMask(const bool* lanes)
+{
+    return packLanes([&](int i) { return lanes[i] ? 1.0f : 0.0f; }) > Pack(0.5f);
+}
+
+/* ---------------------------------------------------------------- *
+   Ray of a pixel, the camera is moved to the top of atmosphere if
+   it is in space. See the atmosphere effect fragment shader.
+ * ---------------------------------------------------------------- */
+struct PixelRay
+{
+    float r;
+    float mu;
+    float muS;
+    float nu;
+    float muHorizon;
+    bool space;
+};
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const glm::ivec2 AtmosphereModel::OpticalDepthSize = glm::ivec2(256, 64);
+const glm::ivec3 AtmosphereModel::ScatteringSize   =
+    glm::ivec3(ScatteringNuSize * ScatteringMuSSize, ScatteringMuSize, ScatteringRSize);
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct AtmosphereModel::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const Atmosphere& atmosphere)
+        : atmosphere(atmosphere)
+    {}
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void bakeOpticalDepth()
+    {
+        const Atmosphere& a = atmosphere;
+        const glm::ivec2 size = OpticalDepthSize;
+        opticalDepthTable.resize(size_t(size.x * size.y) * 2);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int y = 0; y < size.y; ++y)
+        for (int x = 0; x < size.x; x += Pack::width)
+        {
+            float r[Pack::width], mu[Pack::width];
+            for (int i = 0; i < Pack::width; ++i)
+                opticalDepthRMu(a, size,
+                                glm::vec2((float(x + i) + 0.5f) / float(size.x),
+                                          (float(y)     + 0.5f) / float(size.y)),
+                                r[i], mu[i]);
+
+            Pack rayleigh, mie;
+            opticalDepth(a, Pack::load(r), Pack::load(mu),
+                         OpticalDepthSampleCount, rayleigh, mie);
+
+            float* out = &opticalDepthTable[size_t(y * size.x + x) * 2];
+            for (int i = 0; i < Pack::width; ++i)
+            {
+                out[i * 2 + 0] = rayleigh[i];
+                out[i * 2 + 1] = mie[i];
+            }
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Rayleigh optical depth from the optical depth table.
+     * ------------------------------------------------------------ */
+    Pack opticalDepthLookup(const Pack& r, const Pack& mu) const
+    {
+        return packLanes([&](int i)
+        {
+            const glm::vec2 uv = opticalDepthUv(atmosphere, OpticalDepthSize, r[i], mu[i]);
+            return sample2D(opticalDepthTable, OpticalDepthSize, uv).x;
+        });
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void bakeScattering()
+    {
+        if (opticalDepthTable.empty())
+            bakeOpticalDepth();
+
+        const Atmosphere& a = atmosphere;
+        const glm::ivec3 size = ScatteringSize;
+        scatteringTable.resize(size_t(size.x * size.y * size.z) * 4);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int row = 0; row < size.y * size.z; ++row)
+        for (int x = 0; x < size.x; x += Pack::width)
+        {
+            const int y = row % size.y;
+            const int z = row / size.y;
+
+            float r[Pack::width], mu[Pack::width], muS[Pack::width], nu[Pack::width];
+            bool ground[Pack::width];
+            for (int i = 0; i < Pack::width; ++i)
+            {
+                const float fragCoordNu  = std::floor((float(x + i) + 0.5f) / float(ScatteringMuSSize));
+                const float fragCoordMuS = std::fmod(float(x + i) + 0.5f, float(ScatteringMuSSize));
+                const glm::vec4 uvwz(fragCoordNu  / float(ScatteringNuSize - 1),
+                                     fragCoordMuS / float(ScatteringMuSSize),
+                                     (float(y) + 0.5f) / float(ScatteringMuSize),
+                                     (float(z) + 0.5f) / float(ScatteringRSize));
+                scatteringRMuMuSNu(a, uvwz, r[i], mu[i], muS[i], nu[i], ground[i]);
+
+                // Clamp nu into the range that is possible with mu and muS.
+                const float s = std::sqrt((1.0f - mu[i] * mu[i]) * (1.0f - muS[i] * muS[i]));
+                nu[i] = clamp(nu[i], mu[i] * muS[i] - s, mu[i] * muS[i] + s);
+            }
+
+            Pack rayleigh[3], mie;
+            singleScattering(a, Pack::load(r), Pack::load(mu), Pack::load(muS),
+                             Pack::load(nu), packMask(ground),
+                             ScatteringSampleCount,
+                             [&](const Pack& rt, const Pack& muSt)
+                             { return opticalDepthLookup(rt, muSt); },
+                             rayleigh, mie);
+
+            float* out = &scatteringTable[(size_t(row) * size.x + x) * 4];
+            for (int i = 0; i < Pack::width; ++i)
+            {
+                out[i * 4 + 0] = rayleigh[0][i];
+                out[i * 4 + 1] = rayleigh[1][i];
+                out[i * 4 + 2] = rayleigh[2][i];
+                out[i * 4 + 3] = mie[i];
+            }
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Scattering table lookup, the nu slices are interpolated as in
+       the shader.
+     * ------------------------------------------------------------ */
+    glm::vec4 scatteringLookup(float r, float mu, float muS, float nu, bool ground) const
+    {
+        const glm::vec4 uvwz = scatteringUvwz(atmosphere, r, mu, muS, nu, ground);
+        const float texCoordX = uvwz.x * float(ScatteringNuSize - 1);
+        const float texX = std::floor(texCoordX);
+        const float lerp = texCoordX - texX;
+        const glm::vec3 uvw0((texX + uvwz.y)        / float(ScatteringNuSize), uvwz.z, uvwz.w);
+        const glm::vec3 uvw1((texX + 1.0f + uvwz.y) / float(ScatteringNuSize), uvwz.z, uvwz.w);
+        return glm::mix(sample3D(scatteringTable, ScatteringSize, uvw0),
+                        sample3D(scatteringTable, ScatteringSize, uvw1), lerp);
+    }
+
+    /* ------------------------------------------------------------ *
+       In-scattered light of the rays with the phase functions.
+     * ------------------------------------------------------------ */
+    void inScattering(Method method, const View& view,
+                      const Pack& r, const Pack& mu, const Pack& muS,
+                      const Pack& nu, const Pack& ground, Pack color[3]) const
+    {
+        const Atmosphere& a = atmosphere;
+
+        Pack rayleigh[3], mie;
+        if (method == Method::Table)
+        {
+            glm::vec4 lanes[Pack::width];
+            for (int i = 0; i < Pack::width; ++i)
+                lanes[i] = scatteringLookup(r[i], mu[i], muS[i], nu[i], lane(ground, i));
+            for (int c = 0; c < 3; ++c)
+                rayleigh[c] = packLanes([&](int i) { return lanes[i][c]; });
+            mie = packLanes([&](int i) { return lanes[i].w; });
+        }
+        else
+        {
+            singleScattering(a, r, mu, muS, nu, ground,
+                             ReferenceSampleCount,
+                             [&](const Pack& rt, const Pack& muSt)
+                             {
+                                 Pack depthRayleigh, depthMie;
+                                 opticalDepth(a, rt, muSt, ReferenceLightSampleCount,
+                                              depthRayleigh, depthMie);
+                                 return depthRayleigh;
+                             },
+                             rayleigh, mie);
+        }
+
+        const Pack vDotL = -nu;
+        const float g = a.mieAnisotropy;
+        const Pack cos2 = Pack(1.0f) + vDotL * vDotL;
+        const Pack base = Pack(1.0f + g * g) - Pack(2.0f * g) * vDotL;
+        const Pack rayleighPhase = Pack(3.0f / (16.0f * Pi)) * cos2;
+        const Pack miePhase = Pack(3.0f / (8.0f * Pi) * (1.0f - g * g) / (2.0f + g * g)) *
+                              cos2 / (base * sqrt(base));
+
+        for (int c = 0; c < 3; ++c)
+            color[c] = Pack(view.lightIntensity[c]) *
+                       (Pack(a.rayleighScattering[c]) * rayleigh[c] * rayleighPhase +
+                        Pack(a.mieScattering)         * mie         * miePhase);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    PixelRay pixelRay(const glm::vec2& fragCoord) const
+    {
+        const Atmosphere& a = atmosphere;
+
+        // [vp] -> [NDC] -> [view] -> [world]
+        const glm::vec2 ndc = (fragCoord / glm::vec2(viewSize) - 0.5f) * 2.0f;
+        const glm::vec3 eyeDir = glm::normalize(glm::vec3(inverseProjection * glm::vec4(ndc, 0.0f, 1.0f)));
+        const glm::vec3 dir = glm::normalize(inverseTransposeView * eyeDir);
+        glm::vec3 origo = cameraPos;
+
+        PixelRay ray;
+        const float top = a.radius;
+        float r   = glm::length(origo);
+        float rMu = glm::dot(origo, dir);
+        ray.space = false;
+        if (r > top)
+        {
+            ray.space = rMu > 0.0f;
+
+            const float discriminant = rMu * rMu - r * r + top * top;
+            const float tNear = -rMu - std::sqrt(std::max(discriminant, 0.0f));
+            origo += dir * tNear;
+            if (discriminant < 0.0f)
+                origo = glm::normalize(origo) * top;
+            r   = top;
+            rMu = glm::dot(origo, dir);
+        }
+        r = std::max(r, a.planetRadius);
+
+        ray.r   = r;
+        ray.mu  = clamp(rMu / r, -1.0f, 1.0f);
+        ray.muS = clamp(glm::dot(origo, lightDirection) / r, -1.0f, 1.0f);
+        ray.nu  = clamp(glm::dot(dir, lightDirection), -1.0f, 1.0f);
+
+        const float ratio = a.planetRadius / r;
+        ray.muHorizon = -std::sqrt(std::max(1.0f - ratio * ratio, 0.0f));
+        return ray;
+    }
+
+    /* ------------------------------------------------------------ *
+       Renders a row span of pixels. The other side of the limb is
+       needed near the horizon, the width of the texel in mu is
+       taken from the neighbour pixels as fwidth() in the shader.
+     * ------------------------------------------------------------ */
+    void renderSpan(const View& view, Method method, int x, int y, int count,
+                    std::vector<glm::vec3>& sky,
+                    std::vector<glm::vec3>& ground) const
+    {
+        float r[Pack::width], mu[Pack::width], muS[Pack::width], nu[Pack::width], muHorizon[Pack::width];
+        bool isGround[Pack::width], nearLimb[Pack::width], space[Pack::width];
+        for (int i = 0; i < Pack::width; ++i)
+        {
+            const glm::vec2 fragCoord(float(x + std::min(i, count - 1)) + 0.5f, float(y) + 0.5f);
+            const PixelRay ray   = pixelRay(fragCoord);
+            const PixelRay right = pixelRay(fragCoord + glm::vec2(1.0f, 0.0f));
+            const PixelRay up    = pixelRay(fragCoord + glm::vec2(0.0f, 1.0f));
+            const float fwidth = std::abs(right.mu - ray.mu) + std::abs(up.mu - ray.mu);
+
+            r[i]         = ray.r;
+            mu[i]        = ray.mu;
+            muS[i]       = ray.muS;
+            nu[i]        = ray.nu;
+            muHorizon[i] = ray.muHorizon;
+            isGround[i]  = ray.mu < ray.muHorizon;
+            nearLimb[i]  = std::abs(ray.mu - ray.muHorizon) < 2.0f * fwidth;
+            space[i]     = ray.space;
+        }
+
+        const Pack rPack   = Pack::load(r);
+        const Pack muSPack = Pack::load(muS);
+        const Pack nuPack  = Pack::load(nu);
+        const Pack groundMask = packMask(isGround);
+        const Pack limbMask   = packMask(nearLimb);
+        const Pack spaceMask  = packMask(space);
+
+        Pack color[3];
+        inScattering(method, view, rPack, Pack::load(mu), muSPack, nuPack, groundMask, color);
+
+        Pack skyColor[3]    = { color[0], color[1], color[2] };
+        Pack groundColor[3] = { color[0], color[1], color[2] };
+        if (any(limbMask))
+        {
+            Pack other[3];
+            inScattering(method, view, rPack, Pack::load(muHorizon), muSPack, nuPack,
+                         !groundMask, other);
+            for (int c = 0; c < 3; ++c)
+            {
+                skyColor[c]    = select(limbMask & groundMask,  other[c], skyColor[c]);
+                groundColor[c] = select(limbMask & !groundMask, other[c], groundColor[c]);
+            }
+        }
+
+        // The rays that start in space see no atmosphere.
+        for (int c = 0; c < 3; ++c)
+        {
+            skyColor[c]    = select(spaceMask, Pack(0.0f), skyColor[c]);
+            groundColor[c] = select(spaceMask, Pack(0.0f), groundColor[c]);
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const size_t index = size_t(y * viewSize.x + x + i);
+            sky[index]    = glm::vec3(skyColor[0][i],    skyColor[1][i],    skyColor[2][i]);
+            ground[index] = glm::vec3(groundColor[0][i], groundColor[1][i], groundColor[2][i]);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void render(const View& view, Method method,
+                std::vector<glm::vec3>& sky,
+                std::vector<glm::vec3>& ground)
+    {
+        if (method == Method::Table && scatteringTable.empty())
+            bakeScattering();
+
+        const glm::mat4 inverseView = glm::inverse(view.view);
+        inverseProjection    = glm::inverse(view.projection);
+        inverseTransposeView = glm::inverseTranspose(glm::mat3(inverseView));
+        cameraPos            = glm::vec3(inverseView[3]);
+        lightDirection       = glm::normalize(view.lightDirection);
+        viewSize             = view.size;
+
+        sky.resize(size_t(view.size.x * view.size.y));
+        ground.resize(sky.size());
+
+        const glm::ivec2 tiles = (view.size + TileSize - 1) / TileSize;
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int tile = 0; tile < tiles.x * tiles.y; ++tile)
+        {
+            const glm::ivec2 start = glm::ivec2(tile % tiles.x, tile / tiles.x) * TileSize;
+            const glm::ivec2 end   = glm::min(start + TileSize, view.size);
+            for (int y = start.y; y < end.y; ++y)
+            for (int x = start.x; x < end.x; x += Pack::width)
+                renderSpan(view, method, x, y, std::min(Pack::width, end.x - x),
+                           sky, ground);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Atmosphere atmosphere;
+    std::vector<float> opticalDepthTable;
+    std::vector<float> scatteringTable;
+
+    // View of the current render.
+    glm::mat4 inverseProjection;
+    glm::mat3 inverseTransposeView;
+    glm::vec3 cameraPos;
+    glm::vec3 lightDirection;
+    glm::ivec2 viewSize;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+AtmosphereModel::AtmosphereModel(const RendererScene::Atmosphere& atmosphere)
+    : impl(std::make_shared<Impl>(atmosphere))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const RendererScene::Atmosphere& AtmosphereModel::atmosphere() const
+{ return impl->atmosphere; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const std::vector<float>& AtmosphereModel::opticalDepthTable()
+{
+    if (impl->opticalDepthTable.empty())
+    {
+        SUNNE_PROFILE_ZONE("AtmosphereModel::opticalDepthTable");
+        impl->bakeOpticalDepth();
+    }
+    return impl->opticalDepthTable;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const std::vector<float>& AtmosphereModel::scatteringTable()
+{
+    if (impl->scatteringTable.empty())
+    {
+        SUNNE_PROFILE_ZONE("AtmosphereModel::scatteringTable");
+        impl->bakeScattering();
+    }
+    return impl->scatteringTable;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void AtmosphereModel::render(const View& view,
+                             Method method,
+                             std::vector<glm::vec3>& sky,
+                             std::vector<glm::vec3>& ground)
+{
+    SUNNE_PROFILE_ZONE("AtmosphereModel::render");
+    impl->render(view, method, sky, ground);
+}
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,88 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::AtmosphereModel class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "sunne_renderer_scene.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   CPU implementation of the single scattering atmosphere model of
+   the atmosphere shaders. The pixels and the table texels are
+   processed in SIMD packs and the image tiles and the table rows
+   are shared between the OpenMP threads.
+
+   The tables have the same size and layout as the textures of
+   OpenGLAtmosphereEffectRender, they can be uploaded as they are.
+   The model does not depend on OpenGL.
+ * ---------------------------------------------------------------- */
+class AtmosphereModel
+{
+public:
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    enum class Method
+    {
+        Table,     // lookups from the scattering table, as the shader
+        Reference  // integrates the scattering of each pixel
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct View
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::ivec2 size;
+        glm::vec3 lightDirection; // towards the light
+        glm::vec3 lightIntensity;
+    };
+
+    static const glm::ivec2 OpticalDepthSize;  // RG
+    static const glm::ivec3 ScatteringSize;    // RGBA, nu and muS in x
+
+    AtmosphereModel(const RendererScene::Atmosphere& atmosphere);
+
+    const RendererScene::Atmosphere& atmosphere() const;
+
+    /* ------------------------------------------------------------ *
+       Rayleigh and Mie optical depth from the radius to the top of
+       atmosphere. Baked on the first call.
+     * ------------------------------------------------------------ */
+    const std::vector<float>& opticalDepthTable();
+
+    /* ------------------------------------------------------------ *
+       Rayleigh single scattering in RGB and Mie in alpha. Baked on
+       the first call.
+     * ------------------------------------------------------------ */
+    const std::vector<float>& scatteringTable();
+
+    /* ------------------------------------------------------------ *
+       Renders the in-scattering of the rays that miss the ground
+       into the sky image and of the rays that hit the ground into
+       the ground image, as the atmosphere effect shader. Images
+       are bottom-up RGB rows of the view size.
+     * ------------------------------------------------------------ */
+    void render(const View& view,
+                Method method,
+                std::vector<glm::vec3>& sky,
+                std::vector<glm::vec3>& ground);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,258 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::FloatPack template.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SUNNE_FLOAT_PACK_SSE2
+#endif
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SUNNE_FLOAT_PACK_AVX2
+#endif
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   A pack of N floats that are processed together. The generic
+   template loops over the lanes, 4-wide pack uses SSE2 and 8-wide
+   pack AVX2 if the compiler targets them.
+
+   A comparison returns a mask pack where the true lanes have all
+   bits set, select() picks the lanes with the mask.
+ * ---------------------------------------------------------------- */
+template<int N>
+struct FloatPack
+{
+    static const int width = N;
+
+    FloatPack() {}
+    FloatPack(float f) { for (float& v : lanes) v = f; }
+
+    static FloatPack load(const float* p)
+    { FloatPack r; std::memcpy(r.lanes, p, sizeof(lanes)); return r; }
+    void store(float* p) const
+    { std::memcpy(p, lanes, sizeof(lanes)); }
+
+    float operator[](int i) const { return lanes[i]; }
+
+#define SUNNE_FLOAT_PACK_OP(op)                                      \
+    friend FloatPack operator op(const FloatPack& a, const FloatPack& b) \
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = a.lanes[i] op b.lanes[i]; return r; }
+    SUNNE_FLOAT_PACK_OP(+)
+    SUNNE_FLOAT_PACK_OP(-)
+    SUNNE_FLOAT_PACK_OP(*)
+    SUNNE_FLOAT_PACK_OP(/)
+#undef SUNNE_FLOAT_PACK_OP
+
+#define SUNNE_FLOAT_PACK_CMP(op)                                     \
+    friend FloatPack operator op(const FloatPack& a, const FloatPack& b) \
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = mask(a.lanes[i] op b.lanes[i]); return r; }
+    SUNNE_FLOAT_PACK_CMP(<)
+    SUNNE_FLOAT_PACK_CMP(<=)
+    SUNNE_FLOAT_PACK_CMP(>)
+    SUNNE_FLOAT_PACK_CMP(>=)
+#undef SUNNE_FLOAT_PACK_CMP
+
+    friend FloatPack operator-(const FloatPack& a)
+    { return FloatPack(0.0f) - a; }
+
+    friend FloatPack min(const FloatPack& a, const FloatPack& b)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = std::min(a.lanes[i], b.lanes[i]); return r; }
+    friend FloatPack max(const FloatPack& a, const FloatPack& b)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = std::max(a.lanes[i], b.lanes[i]); return r; }
+    friend FloatPack sqrt(const FloatPack& a)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = std::sqrt(a.lanes[i]); return r; }
+    friend FloatPack round(const FloatPack& a)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = std::nearbyint(a.lanes[i]); return r; }
+
+    // 2^n of the integral lanes.
+    friend FloatPack pow2(const FloatPack& n)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = std::ldexp(1.0f, int(n.lanes[i])); return r; }
+
+    friend FloatPack select(const FloatPack& m, const FloatPack& a, const FloatPack& b)
+    {
+        FloatPack r;
+        for (int i = 0; i < N; ++i)
+            r.lanes[i] = bits(m.lanes[i]) ? a.lanes[i] : b.lanes[i];
+        return r;
+    }
+    friend FloatPack operator&(const FloatPack& a, const FloatPack& b)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = mask(bits(a.lanes[i]) && bits(b.lanes[i])); return r; }
+    friend FloatPack operator|(const FloatPack& a, const FloatPack& b)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = mask(bits(a.lanes[i]) || bits(b.lanes[i])); return r; }
+    friend FloatPack operator!(const FloatPack& a)
+    { FloatPack r; for (int i = 0; i < N; ++i) r.lanes[i] = mask(!bits(a.lanes[i])); return r; }
+    friend bool any(const FloatPack& m)
+    { for (int i = 0; i < N; ++i) if (bits(m.lanes[i])) return true; return false; }
+
+private:
+    static float mask(bool b)
+    { const uint32_t u = b ? 0xffffffffu : 0u; float f; std::memcpy(&f, &u, 4); return f; }
+    static uint32_t bits(float f)
+    { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+
+    float lanes[N];
+};
+
+#ifdef SUNNE_FLOAT_PACK_SSE2
+/* ---------------------------------------------------------------- *
+   SSE2 pack.
+ * ---------------------------------------------------------------- */
+template<>
+struct FloatPack<4>
+{
+    static const int width = 4;
+
+    FloatPack() {}
+    FloatPack(float f) : v(_mm_set1_ps(f)) {}
+    FloatPack(__m128 v) : v(v) {}
+
+    static FloatPack load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    float operator[](int i) const
+    { alignas(16) float f[4]; _mm_store_ps(f, v); return f[i]; }
+
+    friend FloatPack operator+(const FloatPack& a, const FloatPack& b) { return _mm_add_ps(a.v, b.v); }
+    friend FloatPack operator-(const FloatPack& a, const FloatPack& b) { return _mm_sub_ps(a.v, b.v); }
+    friend FloatPack operator*(const FloatPack& a, const FloatPack& b) { return _mm_mul_ps(a.v, b.v); }
+    friend FloatPack operator/(const FloatPack& a, const FloatPack& b) { return _mm_div_ps(a.v, b.v); }
+    friend FloatPack operator<(const FloatPack& a, const FloatPack& b)  { return _mm_cmplt_ps(a.v, b.v); }
+    friend FloatPack operator<=(const FloatPack& a, const FloatPack& b) { return _mm_cmple_ps(a.v, b.v); }
+    friend FloatPack operator>(const FloatPack& a, const FloatPack& b)  { return _mm_cmpgt_ps(a.v, b.v); }
+    friend FloatPack operator>=(const FloatPack& a, const FloatPack& b) { return _mm_cmpge_ps(a.v, b.v); }
+    friend FloatPack operator-(const FloatPack& a) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+
+    friend FloatPack min(const FloatPack& a, const FloatPack& b) { return _mm_min_ps(a.v, b.v); }
+    friend FloatPack max(const FloatPack& a, const FloatPack& b) { return _mm_max_ps(a.v, b.v); }
+    friend FloatPack sqrt(const FloatPack& a) { return _mm_sqrt_ps(a.v); }
+    friend FloatPack round(const FloatPack& a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+    friend FloatPack pow2(const FloatPack& n)
+    {
+        const __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+    }
+
+    friend FloatPack select(const FloatPack& m, const FloatPack& a, const FloatPack& b)
+    { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+    friend FloatPack operator&(const FloatPack& a, const FloatPack& b) { return _mm_and_ps(a.v, b.v); }
+    friend FloatPack operator|(const FloatPack& a, const FloatPack& b) { return _mm_or_ps(a.v, b.v); }
+    friend FloatPack operator!(const FloatPack& a)
+    { return _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    friend bool any(const FloatPack& m) { return _mm_movemask_ps(m.v) != 0; }
+
+    __m128 v;
+};
+#endif
+
+#ifdef SUNNE_FLOAT_PACK_AVX2
+/* ---------------------------------------------------------------- *
+   AVX2 pack.
+ * ---------------------------------------------------------------- */
+template<>
+struct FloatPack<8>
+{
+    static const int width = 8;
+
+    FloatPack() {}
+    FloatPack(float f) : v(_mm256_set1_ps(f)) {}
+    FloatPack(__m256 v) : v(v) {}
+
+    static FloatPack load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    float operator[](int i) const
+    { alignas(32) float f[8]; _mm256_store_ps(f, v); return f[i]; }
+
+    friend FloatPack operator+(const FloatPack& a, const FloatPack& b) { return _mm256_add_ps(a.v, b.v); }
+    friend FloatPack operator-(const FloatPack& a, const FloatPack& b) { return _mm256_sub_ps(a.v, b.v); }
+    friend FloatPack operator*(const FloatPack& a, const FloatPack& b) { return _mm256_mul_ps(a.v, b.v); }
+    friend FloatPack operator/(const FloatPack& a, const FloatPack& b) { return _mm256_div_ps(a.v, b.v); }
+    friend FloatPack operator<(const FloatPack& a, const FloatPack& b)  { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend FloatPack operator<=(const FloatPack& a, const FloatPack& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    friend FloatPack operator>(const FloatPack& a, const FloatPack& b)  { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    friend FloatPack operator>=(const FloatPack& a, const FloatPack& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    friend FloatPack operator-(const FloatPack& a) { return _mm256_sub_ps(_mm256_setzero_ps(), a.v); }
+
+    friend FloatPack min(const FloatPack& a, const FloatPack& b) { return _mm256_min_ps(a.v, b.v); }
+    friend FloatPack max(const FloatPack& a, const FloatPack& b) { return _mm256_max_ps(a.v, b.v); }
+    friend FloatPack sqrt(const FloatPack& a) { return _mm256_sqrt_ps(a.v); }
+    friend FloatPack round(const FloatPack& a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    friend FloatPack pow2(const FloatPack& n)
+    {
+        const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+    }
+
+    friend FloatPack select(const FloatPack& m, const FloatPack& a, const FloatPack& b)
+    { return _mm256_blendv_ps(b.v, a.v, m.v); }
+    friend FloatPack operator&(const FloatPack& a, const FloatPack& b) { return _mm256_and_ps(a.v, b.v); }
+    friend FloatPack operator|(const FloatPack& a, const FloatPack& b) { return _mm256_or_ps(a.v, b.v); }
+    friend FloatPack operator!(const FloatPack& a)
+    { return _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    friend bool any(const FloatPack& m) { return _mm256_movemask_ps(m.v) != 0; }
+
+    __m256 v;
+};
+#endif
+
+/* ---------------------------------------------------------------- *
+   Widest pack of the target.
+ * ---------------------------------------------------------------- */
+#if defined(SUNNE_FLOAT_PACK_AVX2)
+using NativeFloatPack = FloatPack<8>;
+#elif defined(SUNNE_FLOAT_PACK_SSE2)
+using NativeFloatPack = FloatPack<4>;
+#else
+using NativeFloatPack = FloatPack<1>;
+#endif
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<int N>
+FloatPack<N> clamp(const FloatPack<N>& x, const FloatPack<N>& lo, const FloatPack<N>& hi)
+{ return min(max(x, lo), hi); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+template<int N>
+FloatPack<N> abs(const FloatPack<N>& x)
+{ return max(x, -x); }
+
+/* ---------------------------------------------------------------- *
+   Natural exponent, the Cephes single precision polynomial. The
+   relative error is about 2e-7 in [-87, 88], the input is clamped
+   into the range.
+ * ---------------------------------------------------------------- */
+template<int N>
+FloatPack<N> exp(const FloatPack<N>& a)
+{
+    using F = FloatPack<N>;
+    const F x = clamp(a, F(-87.0f), F(88.0f));
+    const F n = round(x * F(1.44269504088896341f));
+    const F r = x - n * F(0.693359375f) + n * F(2.12194440e-4f);
+
+    F p = F(1.9875691500e-4f);
+    p = p * r + F(1.3981999507e-3f);
+    p = p * r + F(8.3334519073e-3f);
+    p = p * r + F(4.1665795894e-2f);
+    p = p * r + F(1.6666665459e-1f);
+    p = p * r + F(5.0000001201e-1f);
+    p = p * r * r + r + F(1.0f);
+    return p * pow2(n);
+}
+
+} // namespace sunne
+} // namespace kuu
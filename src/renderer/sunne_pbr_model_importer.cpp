@@ -11,6 +11,7 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/geometric.hpp>
 #include <stb_image.h>
+#include "../sunne_profiler.h"
 
 namespace kuu
 {
@@ -190,6 +191,8 @@ ModelImporter::ModelImporter()
  * ---------------------------------------------------------------- */
 std::vector<ModelImporter::Model> ModelImporter::import(const std::string& filepath) const
 {
+    SUNNE_PROFILE_ZONE("ModelImporter::import");
+
     Assimp::Importer importer;
     const aiScene* scene =
         importer.ReadFile(
@@ -0,0 +1,274 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::PlanetQuadtree class.
+
+   See: Filip Strugar, Continuous Distance-Dependent Level of Detail
+        for Rendering Heightmaps (CDLOD), 2010.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_planet_quadtree.h"
+#include <algorithm>
+#include <math.h>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+#include "../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+using namespace glm;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct PlanetQuadtree::Impl
+{
+    /* ------------------------------------------------------------ *
+       Bounding sphere of a node.
+     * ------------------------------------------------------------ */
+    struct Bounds
+    {
+        vec3 center;
+        float radius;
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const Params& params)
+        : params(params)
+    {}
+
+    /* ------------------------------------------------------------ *
+       Calculates the bounding sphere of the node from the corners,
+       edge midpoints and the center. The margin covers the bulge of
+       the surface between the samples.
+     * ------------------------------------------------------------ */
+    Bounds bounds(int face, const vec2& origin, float size) const
+    {
+        Bounds b;
+        b.center = spherePoint(face, origin + vec2(size * 0.5f)) *
+                   params.radius;
+        b.radius = 0.0f;
+        for (int y = 0; y <= 2; ++y)
+        for (int x = 0; x <= 2; ++x)
+        {
+            const vec2 p = origin + vec2(float(x), float(y)) * size * 0.5f;
+            const vec3 s = spherePoint(face, p) * params.radius;
+            b.radius = std::max(b.radius, length(s - b.center));
+        }
+        b.radius *= 1.1f;
+        return b;
+    }
+
+    /* ------------------------------------------------------------ *
+       Returns true if the bounding sphere is outside of the frustum.
+     * ------------------------------------------------------------ */
+    bool frustumCulled(const Bounds& b) const
+    {
+        for (const vec4& plane : planes)
+            if (dot(vec3(plane), b.center) + plane.w < -b.radius)
+                return true;
+        return false;
+    }
+
+    /* ------------------------------------------------------------ *
+       Returns true if the whole node is below the horizon of the
+       camera. The node covers a cone around its center direction,
+       the horizon is a cone around the camera direction.
+     * ------------------------------------------------------------ */
+    bool horizonCulled(const Bounds& b) const
+    {
+        if (cameraDistance <= params.radius)
+            return false;
+
+        const float horizon = acosf(params.radius / cameraDistance);
+        const float angle   = acosf(std::min(std::max(
+            dot(normalize(b.center), cameraDir), -1.0f), 1.0f));
+        const float extent  = 2.0f * asinf(std::min(
+            b.radius / (2.0f * params.radius), 1.0f));
+        return angle - extent > horizon;
+    }
+
+    /* ------------------------------------------------------------ *
+       Selects the node or its children. Returns false if the node
+       is outside of the range of its level, then the parent has to
+       cover the area of the node.
+     * ------------------------------------------------------------ */
+    bool select(int face, int level, const vec2& origin, float size)
+    {
+        const Bounds b = bounds(face, origin, size);
+        const float distance =
+            std::max(length(cameraPos - b.center) - b.radius, 0.0f);
+
+        if (level > 0 && distance > ranges[size_t(level - 1)])
+            return false;
+
+        if (frustumCulled(b) || horizonCulled(b))
+            return true;
+
+        if (level == params.maxLevel || distance > ranges[size_t(level)])
+        {
+            add(face, level, origin, size, params.gridSize);
+            return true;
+        }
+
+        const float half = size * 0.5f;
+        for (int y = 0; y < 2; ++y)
+        for (int x = 0; x < 2; ++x)
+        {
+            const vec2 childOrigin = origin + vec2(float(x), float(y)) * half;
+            if (!select(face, level + 1, childOrigin, half))
+                add(face, level, childOrigin, half, params.gridSize / 2);
+        }
+        return true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void add(int face, int level, const vec2& origin, float size, int gridSize)
+    {
+        Patch patch;
+        patch.face     = face;
+        patch.level    = level;
+        patch.origin   = origin;
+        patch.size     = size;
+        patch.gridSize = gridSize;
+        patch.morph    = morphs[size_t(level)];
+        patches.push_back(patch);
+    }
+
+    /* ------------------------------------------------------------ *
+       Calculates the LOD ranges. A node is split when the camera is
+       closer than the range of the node level. The quad size of the
+       level is its face arc length divided by the grid size.
+     * ------------------------------------------------------------ */
+    void updateRanges(float screenScale)
+    {
+        const size_t levelCount = size_t(params.maxLevel + 1);
+        ranges.resize(levelCount);
+        morphs.resize(levelCount);
+
+        for (size_t level = 0; level < levelCount; ++level)
+        {
+            const float faceArc  = params.radius * float(M_PI) * 0.5f;
+            const float quadSize = faceArc / float(1 << level) /
+                                   float(params.gridSize);
+            ranges[level] = quadSize * screenScale / params.pixelError;
+        }
+
+        // Level 0 never morphs, the vertices of level N are fully
+        // morphed into level N - 1 grid at the range of level N - 1.
+        morphs[0] = vec2(1e30f, 2e30f);
+        for (size_t level = 1; level < levelCount; ++level)
+        {
+            const float end   = ranges[level - 1];
+            const float start = ranges[level] +
+                                (end - ranges[level]) * params.morphStart;
+            morphs[level] = vec2(start, end);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+       Extracts the frustum planes from the view projection matrix.
+     * ------------------------------------------------------------ */
+    void updatePlanes(const mat4& m)
+    {
+        const vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row3 + row2;
+        planes[5] = row3 - row2;
+        for (vec4& plane : planes)
+            plane /= length(vec3(plane));
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    const std::vector<Patch>& select(const vec3& camera,
+                                     const mat4& viewProjection,
+                                     float screenScale)
+    {
+        cameraPos      = camera;
+        cameraDistance = length(camera);
+        cameraDir      = cameraDistance > 0.0f ? camera / cameraDistance
+                                               : vec3(0.0f, 0.0f, 1.0f);
+        updatePlanes(viewProjection);
+        updateRanges(screenScale);
+
+        patches.clear();
+        for (int face = 0; face < 6; ++face)
+            select(face, 0, vec2(-1.0f), 2.0f);
+        return patches;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Params params;
+    std::vector<float> ranges;
+    std::vector<vec2> morphs;
+    vec4 planes[6];
+    vec3 cameraPos;
+    vec3 cameraDir;
+    float cameraDistance = 0.0f;
+    std::vector<Patch> patches;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+PlanetQuadtree::PlanetQuadtree(const Params& params)
+    : impl(std::make_shared<Impl>(params))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const PlanetQuadtree::Params& PlanetQuadtree::params() const
+{ return impl->params; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const std::vector<PlanetQuadtree::Patch>& PlanetQuadtree::select(
+        const glm::vec3& cameraPos,
+        const glm::mat4& viewProjection,
+        float screenScale)
+{
+    SUNNE_PROFILE_ZONE("PlanetQuadtree::select");
+    return impl->select(cameraPos, viewProjection, screenScale);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+glm::mat3 PlanetQuadtree::faceMatrix(int face)
+{
+    // U-axis, V-axis, normal. U x V is the normal so that the grid
+    // triangles are counter-clockwise when seen from outside.
+    switch (face)
+    {
+        case 0:  return mat3(vec3( 0, 0,-1), vec3(0, 1, 0), vec3( 1, 0, 0));
+        case 1:  return mat3(vec3( 0, 0, 1), vec3(0, 1, 0), vec3(-1, 0, 0));
+        case 2:  return mat3(vec3( 1, 0, 0), vec3(0, 0,-1), vec3( 0, 1, 0));
+        case 3:  return mat3(vec3( 1, 0, 0), vec3(0, 0, 1), vec3( 0,-1, 0));
+        case 4:  return mat3(vec3( 1, 0, 0), vec3(0, 1, 0), vec3( 0, 0, 1));
+        default: return mat3(vec3(-1, 0, 0), vec3(0, 1, 0), vec3( 0, 0,-1));
+    }
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+glm::vec3 PlanetQuadtree::spherePoint(int face, const glm::vec2& p)
+{
+    const vec3 c = faceMatrix(face) * vec3(p, 1.0f);
+    const vec3 c2 = c * c;
+    return vec3(c.x * sqrtf(1.0f - c2.y * 0.5f - c2.z * 0.5f + c2.y * c2.z / 3.0f),
+                c.y * sqrtf(1.0f - c2.z * 0.5f - c2.x * 0.5f + c2.z * c2.x / 3.0f),
+                c.z * sqrtf(1.0f - c2.x * 0.5f - c2.y * 0.5f + c2.x * c2.y / 3.0f));
+}
+
+} // namespace sunne
+} // namespace kuu
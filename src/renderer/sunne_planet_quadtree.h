@@ -0,0 +1,97 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::PlanetQuadtree class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   A continuous level of detail (CDLOD) quadtree of a cube-sphere
+   planet. Each of the six cube faces is the root of a quadtree, a
+   node is split into four when its projected quad size is larger
+   than the allowed pixel error. Nodes outside of the view frustum
+   or below the horizon are culled.
+
+   Every selected patch is drawn with the same grid mesh. A vertex
+   morphs to the grid of the parent level when its distance from the
+   camera approaches the range of the parent, this keeps the seams
+   of the neighbouring levels closed.
+
+   The selection does not depend on OpenGL so that it can be run and
+   timed without a context. All the coordinates are in the planet
+   local space, in kilometers.
+ * ---------------------------------------------------------------- */
+class PlanetQuadtree
+{
+public:
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Params
+    {
+        float radius      = 6371.0f; // km
+        int gridSize      = 32;      // quads per patch edge, power of two
+        int maxLevel      = 16;      // level 0 is the whole face
+        float pixelError  = 8.0f;    // allowed projected quad size, pixels
+        float morphStart  = 0.66f;   // ratio of the range where morph starts
+    };
+
+    /* ------------------------------------------------------------ *
+       A patch of a face to draw. If the grid size is half of the
+       params grid size then the patch is a quadrant of a node whose
+       other quadrants are drawn at the finer level.
+     * ------------------------------------------------------------ */
+    struct Patch
+    {
+        int face;          // cube face, 0..5
+        int level;         // level of the node
+        glm::vec2 origin;  // lower left corner in face coordinates [-1, 1]
+        float size;        // edge length in face coordinates
+        int gridSize;      // quads per patch edge
+        glm::vec2 morph;   // morph start and end distance, km
+    };
+
+    PlanetQuadtree(const Params& params);
+
+    const Params& params() const;
+
+    /* ------------------------------------------------------------ *
+       Selects the patches to draw. Screen scale is the viewport
+       height in pixels divided by 2 * tan(fov / 2), i.e. the half
+       viewport height times the projection matrix [1][1].
+     * ------------------------------------------------------------ */
+    const std::vector<Patch>& select(const glm::vec3& cameraPos,
+                                     const glm::mat4& viewProjection,
+                                     float screenScale);
+
+    /* ------------------------------------------------------------ *
+       Returns the matrix that maps the face coordinates (u, v, 1)
+       into the cube surface. The columns are U-axis, V-axis and the
+       face normal.
+     * ------------------------------------------------------------ */
+    static glm::mat3 faceMatrix(int face);
+
+    /* ------------------------------------------------------------ *
+       Maps the face coordinates into the unit sphere. The cube is
+       spherified so that the patches have nearly equal area.
+     * ------------------------------------------------------------ */
+    static glm::vec3 spherePoint(int face, const glm::vec2& p);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
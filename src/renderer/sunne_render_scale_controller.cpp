@@ -0,0 +1,116 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::RenderScaleController class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_render_scale_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct RenderScaleController::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const Params& params)
+        : params(params)
+        , target(params.maxScale)
+        , quantized(params.maxScale)
+    {}
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    float update(double frameTime)
+    {
+        if (frameTime <= 0.0)
+            return quantized;
+
+        if (settle > 0)
+        {
+            settle--;
+            return quantized;
+        }
+
+        if (filtered <= 0.0)
+            filtered = frameTime;
+        else
+            filtered += params.smoothing * (frameTime - filtered);
+
+        const double ratio = params.targetTime / filtered;
+        if (std::abs(ratio - 1.0) > params.deadband)
+        {
+            // The time follows the pixel count, the scale of the
+            // target time is the square root of the time ratio.
+            const double desired = double(quantized) * std::sqrt(ratio);
+            target += float(params.gain * (desired - double(target)));
+            target = std::min(std::max(target, params.minScale),
+                              params.maxScale);
+        }
+
+        // Hysteresis, the quantized scale moves only when the target
+        // has moved over the half step.
+        if (std::abs(target - quantized) > 0.5f * params.step)
+        {
+            const float steps = std::round(target / params.step);
+            const float scale = std::min(std::max(steps * params.step,
+                                                  params.minScale),
+                                         params.maxScale);
+            if (scale != quantized)
+            {
+                quantized = scale;
+                target    = scale;
+                filtered  = 0.0;
+                settle    = params.settleFrames;
+            }
+        }
+        return quantized;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Params params;
+    double filtered = 0.0;
+    int settle = 0;
+    float target;
+    float quantized;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+RenderScaleController::RenderScaleController(const Params& params)
+    : impl(std::make_shared<Impl>(params))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const RenderScaleController::Params& RenderScaleController::params() const
+{ return impl->params; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+float RenderScaleController::update(double frameTime)
+{ return impl->update(frameTime); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+float RenderScaleController::scale() const
+{ return impl->quantized; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+glm::ivec2 RenderScaleController::scaledSize(const glm::ivec2& size,
+                                             float scale)
+{
+    return glm::ivec2(
+        std::max(int(std::lround(double(size.x) * double(scale))), 1),
+        std::max(int(std::lround(double(size.y) * double(scale))), 1));
+}
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,74 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::RenderScaleController class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <glm/vec2.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Adjusts the render scale of the offscreen passes so that the
+   frame time stays at the target. The GPU time of the passes is
+   assumed to follow the pixel count, i.e. the square of the scale.
+
+   The measured time is low-pass filtered and the scale is only
+   changed when the filtered time is outside of the deadband around
+   the target. The scale is quantized into steps so that it does
+   not change on every frame, a change of the scale drops the
+   history of the temporal passes.
+
+   The GPU times arrive a couple of frames late. After a change the
+   measurements are ignored for the settle frames so that the times
+   of the old scale are not used to correct the new scale.
+ * ---------------------------------------------------------------- */
+class RenderScaleController
+{
+public:
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    struct Params
+    {
+        double targetTime = 14.0;  // frame time, milliseconds
+        float minScale    = 0.5f;
+        float maxScale    = 1.0f;
+        float step        = 0.05f; // quantization of the scale
+        double deadband   = 0.1;   // relative to the target time
+        double smoothing  = 0.2;   // weight of the new measurement
+        double gain       = 0.5;   // fraction of the correction per frame
+        int settleFrames  = 4;     // frames ignored after a change
+    };
+
+    RenderScaleController(const Params& params);
+
+    const Params& params() const;
+
+    /* ------------------------------------------------------------ *
+       Updates the scale from the frame time in milliseconds of the
+       latest measured frame and returns the new scale. A time of
+       zero or less means that there is no measurement yet.
+     * ------------------------------------------------------------ */
+    float update(double frameTime);
+
+    // Returns the current scale.
+    float scale() const;
+
+    /* ------------------------------------------------------------ *
+       Returns the size of the render area of the given full size
+       target at the given scale, at least one pixel.
+     * ------------------------------------------------------------ */
+    static glm::ivec2 scaledSize(const glm::ivec2& size, float scale);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
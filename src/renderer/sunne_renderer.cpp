@@ -20,5 +20,25 @@ Renderer::Renderer()
 Renderer::~Renderer()
 {}
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::vector<Renderer::PassTiming> Renderer::passTimings() const
+{ return std::vector<PassTiming>(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Renderer::StateChanges Renderer::stateChanges()
+{ return StateChanges(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Renderer::keepFrame()
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool Renderer::presentKeptFrame()
+{ return false; }
+
 } // namespace sunne
 } // namespace kuu
@@ -5,7 +5,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <vector>
 #include <glm/vec2.hpp>
 
 namespace kuu
@@ -22,12 +25,46 @@ class RendererScene;
 class Renderer
 {
 public:
+    /* ------------------------------------------------------------ *
+       A rolling average GPU time of a render pass.
+     * ------------------------------------------------------------ */
+    struct PassTiming
+    {
+        std::string name;
+        double gpuTime; // ms
+    };
+
+    /* ------------------------------------------------------------ *
+       Counts of the state changes of the rendered frames.
+     * ------------------------------------------------------------ */
+    struct StateChanges
+    {
+        size_t frames   = 0;
+        size_t issued   = 0; // passed to the graphics API
+        size_t filtered = 0; // skipped as redundant
+    };
+
     Renderer();
     virtual ~Renderer();
     virtual void loadResources(std::shared_ptr<RendererScene> scene) = 0;
     virtual void resize(const glm::ivec2& size) = 0;
     virtual void render(std::shared_ptr<RendererScene> scene) = 0;
     virtual void renderResourceLoadWait() = 0;
+
+    // Returns the GPU times of the render passes in the render
+    // order. Empty if the renderer does not measure them.
+    virtual std::vector<PassTiming> passTimings() const;
+
+    // Returns the state changes since the previous call. Empty if
+    // the renderer does not count them.
+    virtual StateChanges stateChanges();
+
+    // Keeps a copy of the frame that was rendered last. The copy is
+    // dropped by the next render or resize.
+    virtual void keepFrame();
+    // Draws the kept frame into the window again. Returns false if
+    // there is no kept frame, the frame must be rendered then.
+    virtual bool presentKeptFrame();
 };
 
 } // namespace sunne
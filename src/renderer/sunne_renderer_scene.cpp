@@ -4,6 +4,8 @@
  * ---------------------------------------------------------------- */
 
 #include "sunne_renderer_scene.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -15,21 +17,34 @@ namespace sunne
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-glm::mat4 RendererScene::Camera::viewMatrix() const
+glm::mat4 RendererScene::Camera::transformMatrix() const
 {
-    glm::mat4 view(1.0f);
+    glm::mat4 transform(1.0f);
     if (doubleRot)
     {
-        view *= glm::mat4_cast(rotation);
-        view = glm::translate(view, position);
-        view *= glm::mat4_cast(rotation2);
+        transform *= glm::mat4_cast(rotation);
+        transform = glm::translate(transform, position);
+        transform *= glm::mat4_cast(rotation2);
     }
     else
     {
-        view = glm::translate(view, position);
-        view *= glm::mat4_cast(rotation);
+        transform = glm::translate(transform, position);
+        transform *= glm::mat4_cast(rotation);
     }
-    return glm::inverse(view);
+    return transform;
+}
+
+/* ---------------------------------------------------------------- *
+   The transform is rigid, the inverse is the transposed rotation
+   and the rotated negative translation.
+ * ---------------------------------------------------------------- */
+glm::mat4 RendererScene::Camera::viewMatrix() const
+{
+    const glm::mat4 transform = transformMatrix();
+    const glm::mat3 rotationT = glm::transpose(glm::mat3(transform));
+    glm::mat4 view(rotationT);
+    view[3] = glm::vec4(-(rotationT * glm::vec3(transform[3])), 1.0f);
+    return view;
 }
 
 /* ---------------------------------------------------------------- *
@@ -43,6 +58,53 @@ glm::mat4 RendererScene::Camera::projectionMatrix() const
         farPlane);
 }
 
+/* ---------------------------------------------------------------- *
+   The bounds of each axis are found from the tangent lines of the
+   sphere in the plane of the axis and the view direction.
+
+   See: Mara & McGuire, 2D Polyhedral Bounds of a Clipped,
+        Perspective-Projected 3D Sphere, JCGT 2013.
+ * ---------------------------------------------------------------- */
+glm::vec4 RendererScene::Camera::screenBounds(const glm::vec3& center,
+                                              float radius) const
+{
+    const glm::vec3 c = glm::vec3(viewMatrix() * glm::vec4(center, 1.0f));
+    if (c.z - radius > -nearPlane)
+        return glm::vec4(1.0f, 1.0f, -1.0f, -1.0f);
+    if (c.z + radius > -nearPlane)
+        return glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+
+    const glm::mat4 projection = projectionMatrix();
+    glm::vec4 bounds;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        // Sphere center in the plane of the axis and the view
+        // direction, the tangent points are the center rotated by
+        // the half angle of the sphere and scaled by the tangent
+        // length.
+        const glm::vec2 p(c[axis], c.z);
+        const float distance = glm::length(p);
+        const float tangent  = std::sqrt(distance * distance - radius * radius);
+        const float cosAngle = tangent / distance;
+        const float sinAngle = radius  / distance;
+
+        float ndc[2];
+        for (int side = 0; side < 2; ++side)
+        {
+            const float s = side == 0 ? sinAngle : -sinAngle;
+            const glm::vec2 t = glm::vec2(cosAngle * p.x + s * p.y,
+                                          -s * p.x + cosAngle * p.y) * cosAngle;
+            glm::vec4 v(0.0f, 0.0f, t.y, 1.0f);
+            v[axis] = t.x;
+            const glm::vec4 clip = projection * v;
+            ndc[side] = clip[axis] / clip.w;
+        }
+        bounds[axis]     = glm::clamp(std::min(ndc[0], ndc[1]), -1.0f, 1.0f);
+        bounds[axis + 2] = glm::clamp(std::max(ndc[0], ndc[1]), -1.0f, 1.0f);
+    }
+    return bounds;
+}
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 glm::mat4 RendererScene::Satellite::matrix() const
@@ -61,6 +123,8 @@ RendererScene::RendererScene()
     std::shared_ptr<Star> sun = std::make_shared<Star>();
     sun->id     = "sun";
     sun->radius = 696342;
+    sun->direction = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+    sun->intensity = glm::vec3(10.0f, 10.0f, 10.0f);
     stars.push_back(sun);
 
     // Create earth
@@ -10,6 +10,8 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "sunne_texture_compression.h"
 
 namespace kuu
 {
@@ -42,9 +44,18 @@ public:
             }
         };
 
+        // Camera to world transform, the view matrix is its
+        // inverse.
+        glm::mat4 transformMatrix() const;
         glm::mat4 viewMatrix() const;
         glm::mat4 projectionMatrix() const;
 
+        // Returns the normalized device coordinate rectangle (min xy,
+        // max xy) that covers the world space sphere. The rectangle
+        // is the whole viewport if the sphere crosses the near plane
+        // and empty (min > max) if the sphere is behind the camera.
+        glm::vec4 screenBounds(const glm::vec3& center, float radius) const;
+
         glm::vec3 position  = glm::vec3(0.0f, 0.0f, 3.0f);
         glm::quat rotation  = glm::quat();
         glm::quat rotation2 = glm::angleAxis(float(M_PI/3), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -55,6 +66,10 @@ public:
         float nearPlane   = 0.1f;
         float farPlane    = 150.0f;
         Lens lens;
+
+        // Incremented when the camera jumps to a new shot, the
+        // renderer drops the temporal history of the previous shot.
+        int cuts = 0;
     };
 
     /* ------------------------------------------------------------ *
@@ -65,7 +80,34 @@ public:
         std::string id;
         float radius;
         glm::vec3 intensity;
-        glm::vec3 direction;
+        glm::vec3 direction; // world space, towards the star
+    };
+
+    /* ------------------------------------------------------------ *
+       Atmosphere of a planet. The particle densities fall off
+       exponentially with the altitude, the scattering coefficients
+       are at the ground level.
+     * ------------------------------------------------------------ */
+    struct Atmosphere
+    {
+        float planetRadius           = 6360.0f; // km
+        float radius                 = 6420.0f; // km, top of atmosphere
+        float rayleighScaleHeight    = 7.994f;  // km
+        float mieScaleHeight         = 1.2f;    // km
+        glm::vec3 rayleighScattering = glm::vec3(3.8e-4f, 13.5e-4f, 33.1e-4f); // 1/km
+        float mieScattering          = 21e-3f;  // 1/km
+        float mieAnisotropy          = 0.76f;   // g of the phase function
+
+        bool operator==(const Atmosphere& o) const
+        {
+            return planetRadius        == o.planetRadius        &&
+                   radius              == o.radius              &&
+                   rayleighScaleHeight == o.rayleighScaleHeight &&
+                   mieScaleHeight      == o.mieScaleHeight      &&
+                   rayleighScattering  == o.rayleighScattering  &&
+                   mieScattering       == o.mieScattering       &&
+                   mieAnisotropy       == o.mieAnisotropy;
+        }
     };
 
     /* ------------------------------------------------------------ *
@@ -81,8 +123,17 @@ public:
         std::string normalMap;
         std::string cloudMap;
         std::string nightMap;
+        // GPU block compression of the maps
+        texture_compression::Format albedoCompression   = texture_compression::Format::BC7;
+        texture_compression::Format specularCompression = texture_compression::Format::BC4;
+        texture_compression::Format normalCompression   = texture_compression::Format::BC5;
+        texture_compression::Format cloudCompression    = texture_compression::Format::BC3;
+        texture_compression::Format nightCompression    = texture_compression::Format::BC1;
         bool rotate = false;
         glm::vec3 rotateAxis = glm::vec3(0, 1, 0);
+        glm::quat rotation;      // spin, without inclination
+        glm::vec2 cloudMapOffset;
+        Atmosphere atmosphere;
     };
 
     /* ------------------------------------------------------------ *
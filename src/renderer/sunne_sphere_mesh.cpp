@@ -0,0 +1,189 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::sphere_mesh namespace.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_sphere_mesh.h"
+#include <math.h>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace sphere_mesh
+{
+namespace
+{
+
+using namespace glm;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Vertex
+{
+    vec3 pos;
+    vec2 texCoord;
+    vec3 normal;
+    vec3 tangent;
+    vec3 bitangent;
+};
+
+/* ---------------------------------------------------------------- *
+   Calculates the tangent frame of each vertex. Tangents of the
+   triangles that share the vertex are summed weighted by the
+   triangle area and then orthogonalized against the vertex normal.
+   Degenerate triangles (at the poles) are skipped.
+ * ---------------------------------------------------------------- */
+void calculateTangents(std::vector<Vertex>& vertexData,
+                       const std::vector<unsigned>& indexData)
+{
+    std::vector<dvec3> tangents(vertexData.size(), dvec3(0.0));
+    std::vector<dvec3> bitangents(vertexData.size(), dvec3(0.0));
+
+    for (size_t i = 0; i < indexData.size(); i += 3)
+    {
+        const unsigned i1 = indexData[i + 0];
+        const unsigned i2 = indexData[i + 1];
+        const unsigned i3 = indexData[i + 2];
+
+        const Vertex& v1 = vertexData[i1];
+        const Vertex& v2 = vertexData[i2];
+        const Vertex& v3 = vertexData[i3];
+
+        glm::dvec3 edge1 = v2.pos - v1.pos;
+        glm::dvec3 edge2 = v3.pos - v1.pos;
+        glm::dvec2 dUV1 = v2.texCoord - v1.texCoord;
+        glm::dvec2 dUV2 = v3.texCoord - v1.texCoord;
+
+        const double det = dUV1.x * dUV2.y - dUV2.x * dUV1.y;
+        const double area = glm::length(glm::cross(edge1, edge2));
+        if (det == 0.0 || area == 0.0)
+            continue;
+
+        const double f = 1.0 / det;
+
+        glm::dvec3 tangent;
+        tangent.x = f * (dUV2.y * edge1.x - dUV1.y * edge2.x);
+        tangent.y = f * (dUV2.y * edge1.y - dUV1.y * edge2.y);
+        tangent.z = f * (dUV2.y * edge1.z - dUV1.y * edge2.z);
+        tangent = glm::normalize(tangent) * area;
+
+        glm::dvec3 bitangent;
+        bitangent.x = f * (-dUV2.x * edge1.x + dUV1.x * edge2.x);
+        bitangent.y = f * (-dUV2.x * edge1.y + dUV1.x * edge2.y);
+        bitangent.z = f * (-dUV2.x * edge1.z + dUV1.x * edge2.z);
+        bitangent = glm::normalize(bitangent) * area;
+
+        for (unsigned index : { i1, i2, i3 })
+        {
+            tangents[index]   += tangent;
+            bitangents[index] += bitangent;
+        }
+    }
+
+    for (size_t i = 0; i < vertexData.size(); ++i)
+    {
+        Vertex& v = vertexData[i];
+        const dvec3 n = v.normal;
+
+        // Gram-Schmidt, keep the handedness of the bitangent. A vertex
+        // without any valid triangle gets an arbitrary tangent.
+        dvec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+        if (glm::length(t) < 1e-12)
+        {
+            const dvec3 up = fabs(n.y) < 0.99 ? dvec3(0.0, 1.0, 0.0)
+                                                  : dvec3(1.0, 0.0, 0.0);
+            t = glm::cross(up, n);
+        }
+        t = glm::normalize(t);
+
+        dvec3 b = glm::cross(n, t);
+        if (glm::dot(b, bitangents[i]) < 0.0)
+            b = -b;
+
+        v.tangent   = vec3(t);
+        v.bitangent = vec3(b);
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Interleaves the vertex data into the mesh.
+ * ---------------------------------------------------------------- */
+Mesh createMesh(const std::vector<Vertex>& vertexData,
+                std::vector<unsigned>&& indexData)
+{
+    Mesh mesh;
+    mesh.vertices.reserve(vertexData.size() * Mesh::VertexSize);
+    for (const Vertex& v : vertexData)
+    {
+        const float data[Mesh::VertexSize] =
+        {
+            v.pos.x,       v.pos.y,       v.pos.z,
+            v.texCoord.x,  v.texCoord.y,
+            v.normal.x,    v.normal.y,    v.normal.z,
+            v.tangent.x,   v.tangent.y,   v.tangent.z,
+            v.bitangent.x, v.bitangent.y, v.bitangent.z
+        };
+        mesh.vertices.insert(mesh.vertices.end(),
+                             data, data + Mesh::VertexSize);
+    }
+    mesh.indices = std::move(indexData);
+    return mesh;
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Mesh sphere(float radius, int ringCount, int sectorCount)
+{
+    const float pi      = float(M_PI);
+    const float half_pi = pi * 0.5f;
+
+    const float ringStep   = 1.0f / float(ringCount   - 1);
+    const float sectorStep = 1.0f / float(sectorCount - 1);
+
+    std::vector<Vertex> vertexData;
+    for(int r = 0; r < ringCount;   ++r)
+    for(int s = 0; s < sectorCount; ++s)
+    {
+        float y = sin(half_pi + pi * r * ringStep);
+        float x = cos(2.0f * pi * s * sectorStep) * sin(pi * r * ringStep);
+        float z = sin(2.0f * pi * s * sectorStep) * sin(pi * r * ringStep);
+
+        Vertex v;
+        v.pos = vec3(x, y, z) * radius;
+        v.texCoord = vec2(s * sectorStep, r * ringStep);
+        v.normal = normalize(v.pos);
+
+        vertexData.push_back(v);
+    }
+
+    std::vector<unsigned int> indexData;
+    for(int r = 0; r < ringCount   - 1; r++)
+    for(int s = 0; s < sectorCount - 1; s++)
+    {
+        unsigned ia = unsigned((r+0) * sectorCount + (s+0));
+        unsigned ib = unsigned((r+0) * sectorCount + (s+1));
+        unsigned ic = unsigned((r+1) * sectorCount + (s+1));
+        unsigned id = unsigned((r+1) * sectorCount + (s+0));
+
+        indexData.push_back(id);
+        indexData.push_back(ia);
+        indexData.push_back(ib);
+
+        indexData.push_back(ib);
+        indexData.push_back(ic);
+        indexData.push_back(id);
+    }
+
+    calculateTangents(vertexData, indexData);
+    return createMesh(vertexData, std::move(indexData));
+}
+
+} // namespace sphere_mesh
+} // namespace sunne
+} // namespace kuu
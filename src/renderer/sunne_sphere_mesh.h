@@ -0,0 +1,45 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::sphere_mesh namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <vector>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace sphere_mesh
+{
+
+/* ---------------------------------------------------------------- *
+   Interleaved vertex data and triangle indices of an UV sphere. A
+   vertex has 14 floats:
+
+        1) position   (3)
+        2) tex coord  (2)
+        3) normal     (3)
+        4) tangent    (3)
+        5) bitangent  (3)
+
+   The data does not depend on OpenGL so that the generation can be
+   run and timed without a context.
+ * ---------------------------------------------------------------- */
+struct Mesh
+{
+    static const int VertexSize = 14;
+
+    std::vector<float> vertices;
+    std::vector<unsigned> indices;
+};
+
+/* ---------------------------------------------------------------- *
+   Generates an indexed sphere mesh, vertices are shared.
+ * ---------------------------------------------------------------- */
+Mesh sphere(float radius, int ringCount, int sectorCount);
+
+} // namespace sphere_mesh
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,544 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::texture_compression namespace.
+
+   See: https://docs.microsoft.com/en-us/windows/win32/direct3d11/texture-block-compression-in-direct3d-11
+        https://www.khronos.org/registry/DataFormat/specs/1.3/dataformat.1.3.html#BPTC
+ * ---------------------------------------------------------------- */
+
+#include "sunne_texture_compression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace texture_compression
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   RGBA values of a 4x4 block in [0, 255] range. Channels are in
+   separate arrays so that the per-pixel loops vectorize.
+ * ---------------------------------------------------------------- */
+struct Block
+{
+    float c[4][16];
+};
+
+/* ---------------------------------------------------------------- *
+   Reads the block at the block coordinate. Pixels outside of the
+   image are clamped to the edge.
+ * ---------------------------------------------------------------- */
+void loadBlock(const unsigned char* pixels,
+               int width, int height, int channels,
+               int bx, int by,
+               Block& block)
+{
+    for (int y = 0; y < 4; ++y)
+    for (int x = 0; x < 4; ++x)
+    {
+        const int sx = std::min(bx * 4 + x, width  - 1);
+        const int sy = std::min(by * 4 + y, height - 1);
+        const unsigned char* p = pixels + (size_t(sy) * width + sx) * channels;
+        const int i = y * 4 + x;
+        for (int c = 0; c < 4; ++c)
+            block.c[c][i] = c < channels ? float(p[c])
+                                         : (c == 3 ? 255.0f : 0.0f);
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Calculates the mean and the principal axis of the first n
+   channels of the block with a power iteration of the covariance
+   matrix.
+ * ---------------------------------------------------------------- */
+void principalAxis(const Block& block, int n, float mean[4], float axis[4])
+{
+    float mn[4], mx[4];
+    for (int c = 0; c < n; ++c)
+    {
+        float sum = 0.0f;
+        mn[c] = mx[c] = block.c[c][0];
+        for (int i = 0; i < 16; ++i)
+        {
+            sum += block.c[c][i];
+            mn[c] = std::min(mn[c], block.c[c][i]);
+            mx[c] = std::max(mx[c], block.c[c][i]);
+        }
+        mean[c] = sum / 16.0f;
+    }
+
+    float cov[4][4] = {};
+    for (int a = 0; a < n; ++a)
+    for (int b = a; b < n; ++b)
+    {
+        float sum = 0.0f;
+        #pragma omp simd reduction(+:sum)
+        for (int i = 0; i < 16; ++i)
+            sum += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+        cov[a][b] = cov[b][a] = sum;
+    }
+
+    float len2 = 0.0f;
+    for (int c = 0; c < n; ++c)
+    {
+        axis[c] = mx[c] - mn[c];
+        len2 += axis[c] * axis[c];
+    }
+    if (len2 == 0.0f)
+    {
+        for (int c = 0; c < n; ++c)
+            axis[c] = 1.0f;
+        len2 = float(n);
+    }
+
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float v[4] = {};
+        float vlen2 = 0.0f;
+        for (int a = 0; a < n; ++a)
+        {
+            for (int b = 0; b < n; ++b)
+                v[a] += cov[a][b] * axis[b];
+            vlen2 += v[a] * v[a];
+        }
+        if (vlen2 < 1e-12f)
+            break;
+        const float invLen = 1.0f / std::sqrt(vlen2);
+        for (int c = 0; c < n; ++c)
+            axis[c] = v[c] * invLen;
+        len2 = 1.0f;
+    }
+
+    const float invLen = 1.0f / std::sqrt(len2);
+    for (int c = 0; c < n; ++c)
+        axis[c] *= invLen;
+}
+
+/* ---------------------------------------------------------------- *
+   Calculates the endpoints along the principal axis so that the
+   axis covers all the pixels.
+ * ---------------------------------------------------------------- */
+void axisEndpoints(const Block& block, int n,
+                   float e0[4], float e1[4])
+{
+    float mean[4], axis[4];
+    principalAxis(block, n, mean, axis);
+
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < n; ++c)
+            t += (block.c[c][i] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    for (int c = 0; c < n; ++c)
+    {
+        e0[c] = std::min(std::max(mean[c] + axis[c] * tMin, 0.0f), 255.0f);
+        e1[c] = std::min(std::max(mean[c] + axis[c] * tMax, 0.0f), 255.0f);
+    }
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the bits into the block, least significant bit first.
+ * ---------------------------------------------------------------- */
+struct BitWriter
+{
+    unsigned char* out;
+    int pos = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; ++i, ++pos)
+            if ((value >> i) & 1u)
+                out[pos / 8] |= static_cast<unsigned char>(1u << (pos % 8));
+    }
+};
+
+/* ---------------------------------------------------------------- *
+   RGB565 conversions.
+ * ---------------------------------------------------------------- */
+uint16_t to565(const float c[3])
+{
+    auto q = [](float v, int max)
+    {
+        return std::min(std::max(int(v * max / 255.0f + 0.5f), 0), max);
+    };
+    return uint16_t((q(c[0], 31) << 11) | (q(c[1], 63) << 5) | q(c[2], 31));
+}
+
+void from565(uint16_t v, float c[3])
+{
+    const int r = (v >> 11) & 31;
+    const int g = (v >> 5)  & 63;
+    const int b =  v        & 31;
+    c[0] = float((r << 3) | (r >> 2));
+    c[1] = float((g << 2) | (g >> 4));
+    c[2] = float((b << 3) | (b >> 2));
+}
+
+/* ---------------------------------------------------------------- *
+   Calculates the BC1 indices of the endpoints in four color mode.
+   Returns the squared error.
+ * ---------------------------------------------------------------- */
+float bc1Indices(const Block& block, uint16_t c0, uint16_t c1,
+                 uint32_t& indices)
+{
+    float palette[4][3];
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    float error = 0.0f;
+    indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        float best = 1e30f;
+        uint32_t bestIndex = 0;
+        for (uint32_t p = 0; p < 4; ++p)
+        {
+            const float dr = block.c[0][i] - palette[p][0];
+            const float dg = block.c[1][i] - palette[p][1];
+            const float db = block.c[2][i] - palette[p][2];
+            const float d = dr * dr + dg * dg + db * db;
+            if (d < best)
+            {
+                best = d;
+                bestIndex = p;
+            }
+        }
+        error += best;
+        indices |= bestIndex << (2 * i);
+    }
+    return error;
+}
+
+/* ---------------------------------------------------------------- *
+   Encodes the color endpoints and returns the error. Endpoints are
+   ordered for the four color mode.
+ * ---------------------------------------------------------------- */
+float bc1Evaluate(const Block& block, const float e0[3], const float e1[3],
+                  uint16_t& c0, uint16_t& c1, uint32_t& indices)
+{
+    c0 = to565(e0);
+    c1 = to565(e1);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    if (c0 == c1)
+    {
+        // Single color, every index points to c0.
+        indices = 0;
+        float palette[3];
+        from565(c0, palette);
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                error += (block.c[c][i] - palette[c]) * (block.c[c][i] - palette[c]);
+        return error;
+    }
+    return bc1Indices(block, c0, c1, indices);
+}
+
+/* ---------------------------------------------------------------- *
+   Encodes BC1 color block. The endpoints are fitted to the principal
+   axis and then refined once with least squares.
+ * ---------------------------------------------------------------- */
+void encodeBC1(const Block& block, unsigned char* out)
+{
+    float e0[4], e1[4];
+    axisEndpoints(block, 3, e0, e1);
+
+    uint16_t c0, c1;
+    uint32_t indices;
+    float error = bc1Evaluate(block, e1, e0, c0, c1, indices);
+
+    // Weights of c0 for each index.
+    const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        const float a = weights[(indices >> (2 * i)) & 3];
+        const float b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int c = 0; c < 3; ++c)
+        {
+            ax[c] += a * block.c[c][i];
+            bx[c] += b * block.c[c][i];
+        }
+    }
+
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) > 1e-6f)
+    {
+        float r0[3], r1[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            r0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+            r1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+        }
+
+        uint16_t rc0, rc1;
+        uint32_t rIndices;
+        const float rError = bc1Evaluate(block, r0, r1, rc0, rc1, rIndices);
+        if (rError < error)
+        {
+            c0 = rc0;
+            c1 = rc1;
+            indices = rIndices;
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(c0 & 0xff);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1 & 0xff);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+/* ---------------------------------------------------------------- *
+   Encodes BC4 single channel block with the eight value mode.
+ * ---------------------------------------------------------------- */
+void encodeBC4(const float values[16], unsigned char* out)
+{
+    float mn = values[0], mx = values[0];
+    for (int i = 1; i < 16; ++i)
+    {
+        mn = std::min(mn, values[i]);
+        mx = std::max(mx, values[i]);
+    }
+
+    const int a0 = int(mx + 0.5f);
+    const int a1 = int(mn + 0.5f);
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+
+    uint64_t bits = 0;
+    if (a0 > a1)
+    {
+        float palette[8];
+        palette[0] = float(a0);
+        palette[1] = float(a1);
+        for (int i = 2; i < 8; ++i)
+            palette[i] = float((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            float best = 1e30f;
+            uint64_t bestIndex = 0;
+            for (uint64_t p = 0; p < 8; ++p)
+            {
+                const float d = std::abs(values[i] - palette[p]);
+                if (d < best)
+                {
+                    best = d;
+                    bestIndex = p;
+                }
+            }
+            bits |= bestIndex << (3 * i);
+        }
+    }
+
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<unsigned char>((bits >> (8 * i)) & 0xff);
+}
+
+/* ---------------------------------------------------------------- *
+   Quantizes the endpoint into 7-bits per channel and a shared
+   p-bit, returns the 8-bit values and the p-bit.
+ * ---------------------------------------------------------------- */
+int quantizeMode6(const float e[4], int q[4])
+{
+    int bestP = 0;
+    float bestError = 1e30f;
+    int candidate[2][4];
+    for (int p = 0; p < 2; ++p)
+    {
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            const int v = std::min(std::max(int((e[c] - p) / 2.0f + 0.5f), 0), 127);
+            candidate[p][c] = v;
+            const float d = float((v << 1) | p) - e[c];
+            error += d * d;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            bestP = p;
+        }
+    }
+    for (int c = 0; c < 4; ++c)
+        q[c] = candidate[bestP][c];
+    return bestP;
+}
+
+/* ---------------------------------------------------------------- *
+   Encodes BC7 block with mode 6: single subset, RGBA endpoints with
+   7-bit channels and unique p-bits, 4-bit indices.
+ * ---------------------------------------------------------------- */
+void encodeBC7Mode6(const Block& block, unsigned char* out)
+{
+    static const int weights[16] =
+    { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    float e0[4], e1[4];
+    axisEndpoints(block, 4, e0, e1);
+
+    int q0[4], q1[4];
+    int p0 = quantizeMode6(e0, q0);
+    int p1 = quantizeMode6(e1, q1);
+
+    float palette[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c)
+        {
+            const int v0 = (q0[c] << 1) | p0;
+            const int v1 = (q1[c] << 1) | p1;
+            palette[i][c] = float(((64 - weights[i]) * v0 + weights[i] * v1 + 32) >> 6);
+        }
+
+    int indices[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        float best = 1e30f;
+        int bestIndex = 0;
+        for (int p = 0; p < 16; ++p)
+        {
+            float d = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                const float diff = block.c[c][i] - palette[p][c];
+                d += diff * diff;
+            }
+            if (d < best)
+            {
+                best = d;
+                bestIndex = p;
+            }
+        }
+        indices[i] = bestIndex;
+    }
+
+    // The most significant bit of the anchor index is implicitly
+    // zero, swap the endpoints if needed.
+    if (indices[0] & 8)
+    {
+        for (int c = 0; c < 4; ++c)
+            std::swap(q0[c], q1[c]);
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; ++i)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer { out };
+    writer.write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.write(uint32_t(q0[c]), 7);
+        writer.write(uint32_t(q1[c]), 7);
+    }
+    writer.write(uint32_t(p0), 1);
+    writer.write(uint32_t(p1), 1);
+    writer.write(uint32_t(indices[0]), 3);
+    for (int i = 1; i < 16; ++i)
+        writer.write(uint32_t(indices[i]), 4);
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+size_t blockSize(Format format)
+{
+    switch (format)
+    {
+        case Format::None: return 0;
+        case Format::BC1:  return 8;
+        case Format::BC3:  return 16;
+        case Format::BC4:  return 8;
+        case Format::BC5:  return 16;
+        case Format::BC7:  return 16;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+size_t compressedSize(Format format, int width, int height)
+{
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockSize(format);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void encode(Format format,
+            const unsigned char* pixels,
+            int width,
+            int height,
+            int channels,
+            unsigned char* out)
+{
+    const int blocksX = (width  + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    const size_t size = blockSize(format);
+    if (size == 0)
+        return;
+
+    #pragma omp parallel for schedule(dynamic, 4)
+    for (int by = 0; by < blocksY; ++by)
+    {
+        Block block;
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            unsigned char* dst = out + (size_t(by) * blocksX + bx) * size;
+            loadBlock(pixels, width, height, channels, bx, by, block);
+            switch (format)
+            {
+                case Format::BC1:
+                    encodeBC1(block, dst);
+                    break;
+
+                case Format::BC3:
+                    encodeBC4(block.c[3], dst);
+                    encodeBC1(block, dst + 8);
+                    break;
+
+                case Format::BC4:
+                    encodeBC4(block.c[0], dst);
+                    break;
+
+                case Format::BC5:
+                    encodeBC4(block.c[0], dst);
+                    encodeBC4(block.c[1], dst + 8);
+                    break;
+
+                case Format::BC7:
+                    encodeBC7Mode6(block, dst);
+                    break;
+
+                case Format::None:
+                    break;
+            }
+        }
+    }
+}
+
+} // namespace texture_compression
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,63 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::texture_compression namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace texture_compression
+{
+
+/* ---------------------------------------------------------------- *
+   Block compression formats. Each block is 4x4 pixels.
+
+    None  Uncompressed.
+    BC1   RGB, 8 bytes per block.
+    BC3   RGBA, BC1 color + BC4 alpha, 16 bytes per block.
+    BC4   R, 8 bytes per block.
+    BC5   RG, two BC4 blocks, 16 bytes per block.
+    BC7   RGBA, 16 bytes per block. Only mode 6 is encoded.
+ * ---------------------------------------------------------------- */
+enum class Format
+{
+    None,
+    BC1,
+    BC3,
+    BC4,
+    BC5,
+    BC7
+};
+
+/* ---------------------------------------------------------------- *
+   Returns the count of bytes per 4x4 block of the format, zero if
+   the format is not compressed.
+ * ---------------------------------------------------------------- */
+size_t blockSize(Format format);
+
+/* ---------------------------------------------------------------- *
+   Returns the size of the compressed image in bytes.
+ * ---------------------------------------------------------------- */
+size_t compressedSize(Format format, int width, int height);
+
+/* ---------------------------------------------------------------- *
+   Encodes the 8-bits per channel image into the blocks. Output must
+   have compressedSize() bytes. Missing channels of the image are
+   read as zero, alpha as 255. The block rows are encoded in
+   parallel.
+ * ---------------------------------------------------------------- */
+void encode(Format format,
+            const unsigned char* pixels,
+            int width,
+            int height,
+            int channels,
+            unsigned char* out);
+
+} // namespace texture_compression
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,87 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::Arguments struct.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_arguments.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Arguments::Arguments(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--software")
+            software = true;
+        else if (arg == "--benchmark")
+        {
+            benchmark = true;
+            if (i + 1 < argc && std::string(argv[i + 1]).find("--") != 0)
+                benchmarkOutput = argv[++i];
+        }
+        else if (arg == "--gpu-timings")
+            gpuTimings = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            traceOutput = argv[++i];
+        else if (arg == "--atmosphere-resolution" && i + 1 < argc)
+        {
+            const std::string resolution = argv[++i];
+            if (resolution == "full")
+                atmosphereDivisor = 1;
+            else if (resolution == "half")
+                atmosphereDivisor = 2;
+            else if (resolution == "quarter")
+                atmosphereDivisor = 4;
+            else
+                std::cerr << __FUNCTION__ << ": unknown atmosphere resolution "
+                          << resolution << std::endl;
+        }
+        else if (arg == "--atmosphere-temporal" && i + 1 < argc)
+        {
+            const std::string temporal = argv[++i];
+            if (temporal == "on")
+                atmosphereTemporal = true;
+            else if (temporal == "off")
+                atmosphereTemporal = false;
+            else
+                std::cerr << __FUNCTION__ << ": unknown atmosphere temporal mode "
+                          << temporal << std::endl;
+        }
+        else if (arg == "--cpu-atmosphere")
+            cpuAtmosphere = true;
+        else if (arg == "--dynamic-resolution")
+        {
+            dynamicResolution = true;
+            if (i + 1 < argc && std::string(argv[i + 1]).find("--") != 0)
+            {
+                const std::string time = argv[++i];
+                const double ms = std::atof(time.c_str());
+                if (ms > 0.0)
+                    targetFrameTime = ms;
+                else
+                    std::cerr << __FUNCTION__ << ": invalid target frame time "
+                              << time << std::endl;
+            }
+        }
+        else if (arg == "--shader-hot-reload")
+            shaderHotReload = true;
+        else if (arg == "--fused-forward")
+            fusedForward = true;
+        else
+            std::cerr << __FUNCTION__ << ": unknown argument "
+                      << arg << std::endl;
+    }
+}
+
+} // namespace sunne
+} // namespace kuu
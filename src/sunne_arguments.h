@@ -0,0 +1,102 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::Arguments struct.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Command line arguments of the application.
+
+    --headless  Renders into an offscreen EGL pbuffer instead of
+                a GLFW window. No display server is needed.
+    --software  Forces the Mesa software rasterizer (llvmpipe)
+                for the headless context.
+    --benchmark [file]
+                Runs the whole cut sequence with a fixed timestep
+                and v-sync off. Frame timings are written into
+                file.csv and file.json, default file is
+                sunne_benchmark.
+    --gpu-timings
+                Prints the average GPU time of each render pass
+                once per second.
+    --trace file
+                Records the CPU profiler zones and writes them into
+                a Chrome trace JSON file at exit.
+    --atmosphere-resolution full|half|quarter
+                Resolution of the atmosphere pass relative to the
+                window, default is half.
+    --atmosphere-temporal on|off
+                Renders a quarter of the atmosphere pass each frame
+                and reprojects the rest from the previous frame,
+                default is on.
+    --cpu-atmosphere
+                Renders the atmosphere on the CPU.
+    --dynamic-resolution [ms]
+                Scales the resolution of the offscreen passes each
+                frame to hold the GPU frame time at the target,
+                default target is 14 ms.
+    --shader-hot-reload
+                Watches the shader files and rebuilds the changed
+                programs while running.
+    --fused-forward
+                Renders the planet and the sky with the atmosphere
+                directly into the window without the compose.
+ * ---------------------------------------------------------------- */
+struct Arguments
+{
+    // Parses the arguments from the main entry parameters.
+    Arguments(int argc, char* argv[]);
+
+    // If true then the application is run without a window.
+    bool headless = false;
+
+    // If true then the software rasterizer is forced.
+    bool software = false;
+
+    // If true then the benchmark is run.
+    bool benchmark = false;
+
+    // Output file path of the benchmark report without the
+    // file extension.
+    std::string benchmarkOutput = "sunne_benchmark";
+
+    // If true then the render pass GPU times are printed.
+    bool gpuTimings = false;
+
+    // Output file path of the CPU trace. Empty if the trace is
+    // not recorded.
+    std::string traceOutput;
+
+    // Divisor of the atmosphere pass resolution: 1, 2 or 4.
+    int atmosphereDivisor = 2;
+
+    // If true then the atmosphere pass is accumulated temporally.
+    bool atmosphereTemporal = true;
+
+    // If true then the atmosphere is rendered on the CPU.
+    bool cpuAtmosphere = false;
+
+    // If true then the render scale follows the frame time.
+    bool dynamicResolution = false;
+
+    // Target GPU frame time of the dynamic resolution in
+    // milliseconds.
+    double targetFrameTime = 14.0;
+
+    // If true then the changed shaders are rebuilt while running.
+    bool shaderHotReload = false;
+
+    // If true then the fused forward path is rendered.
+    bool fusedForward = false;
+};
+
+} // namespace sunne
+} // namespace kuu
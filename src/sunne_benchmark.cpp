@@ -0,0 +1,328 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::Benchmark class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <glad/glad.h>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Summary of a timing series in milliseconds.
+ * ---------------------------------------------------------------- */
+struct Summary
+{
+    size_t count = 0;
+    double mean  = 0.0;
+    double p50   = 0.0;
+    double p95   = 0.0;
+    double p99   = 0.0;
+    double max   = 0.0;
+};
+
+/* ---------------------------------------------------------------- *
+   Calculates the summary of the values. Negative values are
+   unknown and they are skipped. Percentiles are nearest-rank.
+ * ---------------------------------------------------------------- */
+Summary summarize(std::vector<double> values)
+{
+    values.erase(std::remove_if(values.begin(), values.end(),
+                                [](double v) { return v < 0.0; }),
+                 values.end());
+
+    Summary s;
+    s.count = values.size();
+    if (values.empty())
+        return s;
+
+    std::sort(values.begin(), values.end());
+
+    auto percentile = [&](double p)
+    {
+        const double rank = std::ceil(p / 100.0 * double(values.size()));
+        const size_t index = size_t(std::max(rank, 1.0)) - 1;
+        return values[std::min(index, values.size() - 1)];
+    };
+
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+
+    s.mean = sum / double(values.size());
+    s.p50  = percentile(50.0);
+    s.p95  = percentile(95.0);
+    s.p99  = percentile(99.0);
+    s.max  = values.back();
+    return s;
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the summary as a JSON object.
+ * ---------------------------------------------------------------- */
+void writeJson(std::ostream& out, const std::string& name, const Summary& s)
+{
+    out << "    \"" << name << "\": { "
+        << "\"count\": " << s.count << ", "
+        << "\"mean\": "  << s.mean  << ", "
+        << "\"p50\": "   << s.p50   << ", "
+        << "\"p95\": "   << s.p95   << ", "
+        << "\"p99\": "   << s.p99   << ", "
+        << "\"max\": "   << s.max   << " }";
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the summary as a line of text.
+ * ---------------------------------------------------------------- */
+void writeText(std::ostream& out, const std::string& name, const Summary& s)
+{
+    out << name   << ": "
+        << "p50 " << s.p50 << " ms, "
+        << "p95 " << s.p95 << " ms, "
+        << "p99 " << s.p99 << " ms, "
+        << "max " << s.max << " ms"
+        << std::endl;
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the value into CSV, unknown value is left empty.
+ * ---------------------------------------------------------------- */
+void writeCsv(std::ostream& out, double value)
+{
+    out << ",";
+    if (value >= 0.0)
+        out << value;
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Benchmark::Impl
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Count of frames the GPU results are allowed to lag behind.
+    static const int QueryLatency = 4;
+
+    /* ------------------------------------------------------------ *
+       Timings of a frame in milliseconds, negative is unknown.
+     * ------------------------------------------------------------ */
+    struct Frame
+    {
+        double cpu      = -1.0;
+        double gpu      = -1.0;
+        double interval = -1.0;
+    };
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl()
+    {
+        const GLubyte* r = glGetString(GL_RENDERER);
+        if (r)
+            renderer = reinterpret_cast<const char*>(r);
+
+        glGenQueries(QueryLatency * 2, &queries[0][0]);
+        std::fill(queryFrame, queryFrame + QueryLatency, -1);
+    }
+
+    /* ------------------------------------------------------------ *
+       Reads the GPU time of the frame in query slot. Returns false
+       if the result is not yet available and wait is false.
+     * ------------------------------------------------------------ */
+    bool resolve(int slot, bool wait)
+    {
+        if (queryFrame[slot] < 0)
+            return true;
+
+        if (!wait)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][1],
+                               GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+            if (!available)
+                return false;
+        }
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+
+        frames[size_t(queryFrame[slot])].gpu = double(end - start) / 1.0e6;
+        queryFrame[slot] = -1;
+        return true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void beginFrame()
+    {
+        if (finished)
+            return;
+
+        const Clock::time_point now = Clock::now();
+        if (!frames.empty())
+            frames.back().interval =
+                std::chrono::duration<double, std::milli>(
+                    now - frameStart).count();
+        frameStart = now;
+
+        for (int i = 0; i < QueryLatency; ++i)
+            resolve(i, false);
+
+        // The slot is still in use only if the GPU is more than the
+        // query latency behind, then the wait is unavoidable.
+        slot = int(frames.size() % QueryLatency);
+        resolve(slot, true);
+
+        glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void endFrame()
+    {
+        if (finished)
+            return;
+
+        glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+        queryFrame[slot] = int(frames.size());
+
+        Frame frame;
+        frame.cpu = std::chrono::duration<double, std::milli>(
+            Clock::now() - frameStart).count();
+        frames.push_back(frame);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void finish()
+    {
+        if (finished)
+            return;
+
+        for (int i = 0; i < QueryLatency; ++i)
+            resolve(i, true);
+        glDeleteQueries(QueryLatency * 2, &queries[0][0]);
+        finished = true;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void write(const std::string& filePath) const
+    {
+        std::vector<double> cpu, gpu, interval;
+        for (const Frame& f : frames)
+        {
+            cpu.push_back(f.cpu);
+            gpu.push_back(f.gpu);
+            interval.push_back(f.interval);
+        }
+
+        const Summary cpuSummary      = summarize(cpu);
+        const Summary gpuSummary      = summarize(gpu);
+        const Summary intervalSummary = summarize(interval);
+
+        std::ofstream csv(filePath + ".csv");
+        if (!csv.is_open())
+            throw std::runtime_error(
+                std::string(__FUNCTION__) +
+                ": failed to open " + filePath + ".csv");
+
+        csv << "frame,time_ms,cpu_ms,gpu_ms,frame_ms" << std::endl;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            csv << i << "," << double(i) * TimeStep;
+            writeCsv(csv, frames[i].cpu);
+            writeCsv(csv, frames[i].gpu);
+            writeCsv(csv, frames[i].interval);
+            csv << std::endl;
+        }
+
+        std::ofstream json(filePath + ".json");
+        if (!json.is_open())
+            throw std::runtime_error(
+                std::string(__FUNCTION__) +
+                ": failed to open " + filePath + ".json");
+
+        std::string escapedRenderer;
+        for (char c : renderer)
+        {
+            if (c == '"' || c == '\\')
+                escapedRenderer += '\\';
+            escapedRenderer += c;
+        }
+
+        json << "{" << std::endl
+             << "    \"renderer\": \"" << escapedRenderer << "\"," << std::endl
+             << "    \"frames\": "     << frames.size()   << ","  << std::endl
+             << "    \"timestep_ms\": " << TimeStep       << ","  << std::endl;
+        writeJson(json, "cpu_ms",   cpuSummary);      json << "," << std::endl;
+        writeJson(json, "gpu_ms",   gpuSummary);      json << "," << std::endl;
+        writeJson(json, "frame_ms", intervalSummary); json << std::endl;
+        json << "}" << std::endl;
+
+        std::cout << "Benchmark: " << frames.size() << " frames, "
+                  << renderer << std::endl;
+        writeText(std::cout, "  CPU",   cpuSummary);
+        writeText(std::cout, "  GPU",   gpuSummary);
+        writeText(std::cout, "  Frame", intervalSummary);
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    std::vector<Frame> frames;
+    std::string renderer;
+    Clock::time_point frameStart;
+    GLuint queries[QueryLatency][2];
+    int queryFrame[QueryLatency];
+    int slot = 0;
+    bool finished = false;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+constexpr double Benchmark::TimeStep;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Benchmark::Benchmark()
+    : impl(std::make_shared<Impl>())
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Benchmark::beginFrame()
+{ impl->beginFrame(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Benchmark::endFrame()
+{ impl->endFrame(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Benchmark::finish()
+{ impl->finish(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Benchmark::write(const std::string& filePath) const
+{ impl->write(filePath); }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,48 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::Benchmark class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Records the CPU time, GPU time and frame interval of each frame
+   and writes a report with percentiles. GPU time is measured with
+   timestamp queries that are read without stalling when available.
+   Functions must be called from the thread that owns the OpenGL
+   context.
+ * ---------------------------------------------------------------- */
+class Benchmark
+{
+public:
+    // Fixed timestep of the simulation in milliseconds.
+    static constexpr double TimeStep = 1000.0 / 60.0;
+
+    Benchmark();
+
+    // Call at the start of the frame, before update.
+    void beginFrame();
+    // Call at the end of the frame, after render.
+    void endFrame();
+    // Stops the recording and waits for all GPU results.
+    void finish();
+
+    // Writes the per-frame timings into filePath.csv and the
+    // summary into filePath.json.
+    void write(const std::string& filePath) const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -106,9 +106,19 @@ struct CameraOrbit::Impl
         const float cutA = 23550.0f;
         const float cutB = 46000.0f;
         const float cutC = 59000.0f;
+
+        const int shot = totTime < cutA ? 0 :
+                         totTime < cutB ? 1 :
+                         totTime < cutC ? 2 : 3;
+        if (shot != currentShot)
+        {
+            camera->cuts++;
+            currentShot = shot;
+        }
+
         if (totTime < cutA)
         {
-            auto camPos = map(glm::inverse(camera->viewMatrix()));
+            auto camPos = map(camera->transformMatrix());
             auto tgtPos = map(targetSatellite->matrix());
             auto dir    = glm::normalize(camPos - tgtPos);
             camera->rotation = lookAt(dir, glm::vec3(0, 1, 0));
@@ -133,7 +143,7 @@ struct CameraOrbit::Impl
             }
 
             auto tgtPos = map(targetSatellite->matrix());
-            auto camPos = map(glm::inverse(camera->viewMatrix()));
+            auto camPos = map(camera->transformMatrix());
             auto dir    = glm::normalize(camPos - tgtPos);
             camera->rotation = lookAt(dir, glm::vec3(0, 1, 0));
             camera->position = tgtPos + glm::vec3(10.0f, 10.0f, 10.0f);
@@ -148,7 +158,7 @@ struct CameraOrbit::Impl
             }
 
             auto tgtPos = map(targetSatellite->matrix());
-            auto camPos = map(glm::inverse(camera->viewMatrix()));
+            auto camPos = map(camera->transformMatrix());
             auto dir    = glm::normalize(camPos - tgtPos);
             camera->rotation = lookAt(dir, glm::vec3(0, 1, 0));
             camera->position = tgtPos + glm::vec3(10.0f, 10.0f, -10.0f);
@@ -176,6 +186,7 @@ struct CameraOrbit::Impl
     std::shared_ptr<RendererScene::Satellite> targetSatellite;
     float focalLengthAnimation = 0.0f;
     float totTime = 0.0f;
+    int currentShot = 0;
     bool cutSetB = false;
     bool cutSetC = false;
     bool cutSetD = false;
@@ -4,14 +4,19 @@
  * ---------------------------------------------------------------- */
 
 #include "sunne_controller.h"
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include "renderer/opengl/sunne_opengl_renderer.h"
 #include "renderer/sunne_renderer_scene.h"
+#include "window/sunne_opengl_headless_window.h"
 #include "window/sunne_opengl_window.h"
 #include "window/sunne_window_parameters.h"
 #include "window/sunne_window_user_input.h"
-#include "sunne_camera_orbit.h"
-#include "sunne_satellite_orbit.h"
+#include "sunne_arguments.h"
+#include "sunne_benchmark.h"
+#include "sunne_profiler.h"
+#include "sunne_simulation.h"
 
 namespace kuu
 {
@@ -24,14 +29,13 @@ struct Controller::Impl
 {
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    Impl(Controller* self)
+    Impl(Controller* self, const Arguments& args)
         : self(self)
+        , args(args)
         , closeApp(false)
         , resourceLoadStart(true)
         , resourceLoad(false)
         , paused(false)
-        , endCut(false)
-        , totTime(0.0f)
     {}
 
     /* ------------------------------------------------------------ *
@@ -48,38 +52,42 @@ struct Controller::Impl
         WindowParams params;
         params.opengl.major = 3;
         params.opengl.minor = 3;
-        params.vSync        = true;
+        params.opengl.software = args.software;
+        params.vSync        = !args.headless && !args.benchmark;
         params.title        = "Sunne";
         params.callback     = self;
         params.fullscreen   = false;
         params.size.x       = 1920;
         params.size.y       = 817;
 
-        window = std::make_shared<OpenGLWindow>(params);
+        if (args.headless)
+            window = std::make_shared<OpenGLHeadlessWindow>(params);
+        else
+            window = std::make_shared<OpenGLWindow>(params);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void createRenderer(const glm::ivec2& size)
     {
-        renderer = std::make_shared<OpenGLRenderer>(size);
-    }
-
-    /* ------------------------------------------------------------ *
-     * ------------------------------------------------------------ */
-    void createCameraOrbit()
-    {
-        cameraOrbit = std::make_shared<CameraOrbit>(scene->camera);
+        OpenGLRenderer::Params params;
+        params.atmosphereDivisor  = args.atmosphereDivisor;
+        params.atmosphereTemporal = args.atmosphereTemporal;
+        params.cpuAtmosphere      = args.cpuAtmosphere;
+        params.dynamicResolution  = args.dynamicResolution;
+        params.targetFrameTime    = args.targetFrameTime;
+        params.shaderHotReload    = args.shaderHotReload;
+        params.fusedForward       = args.fusedForward;
+        renderer = std::make_shared<OpenGLRenderer>(size, params);
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
-    void createSatelliteOrbit()
+    void createSimulation()
     {
-        satelliteOrbit = std::make_shared<SatelliteOrbit>(scene->satellite);
+        simulation = std::make_shared<Simulation>(*scene);
     }
 
-
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     void resize(const glm::ivec2& size)
@@ -103,17 +111,71 @@ struct Controller::Impl
         {
             renderer->renderResourceLoadWait();
         }
+        else if (!simulation->update() && isIdle() &&
+                 renderer->presentKeptFrame())
+        {
+            // The scene has not changed since the kept frame.
+        }
         else
         {
+            const Simulation::Snapshot& snapshot = simulation->snapshot();
+            snapshot.apply(*scene);
             renderer->render(scene);
+            if (isIdle())
+                renderer->keepFrame();
+            if (snapshot.ended)
+                endRendered = true;
+        }
+
+        if (benchmarkFrame)
+            benchmark->endFrame();
+    }
+
+    /* ------------------------------------------------------------ *
+       Returns true if the scene does not change between the frames.
+       The hot reload renders the frames to show the shader edits.
+     * ------------------------------------------------------------ */
+    bool isIdle() const
+    {
+        return paused && !resourceLoad && !benchmark &&
+               !args.shaderHotReload;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void printPassTimings()
+    {
+        // Formatted locally, the flags would stay on std::cout.
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(3);
+
+        double total = 0.0;
+        line << "GPU:";
+        for (const Renderer::PassTiming& timing : renderer->passTimings())
+        {
+            line << " " << timing.name << " "
+                 << timing.gpuTime << " ms";
+            total += timing.gpuTime;
+        }
+        line << ", total " << total << " ms";
+        std::cout << line.str() << std::endl;
+
+        const Renderer::StateChanges changes = renderer->stateChanges();
+        if (changes.frames > 0)
+        {
+            std::cout << "GL state changes per frame: "
+                      << changes.issued / changes.frames << " issued, "
+                      << changes.filtered / changes.frames << " filtered"
+                      << std::endl;
         }
     }
 
     /* ------------------------------------------------------------ *
      * ------------------------------------------------------------ */
     Controller* self;
-    std::shared_ptr<CameraOrbit> cameraOrbit;
-    std::shared_ptr<SatelliteOrbit> satelliteOrbit;
+    Arguments args;
+    std::shared_ptr<Simulation> simulation;
+    std::shared_ptr<Benchmark> benchmark;
     std::shared_ptr<Window> window;
     std::shared_ptr<Renderer> renderer;
     std::shared_ptr<RendererScene> scene;
@@ -121,15 +183,22 @@ struct Controller::Impl
     bool resourceLoadStart;
     bool resourceLoad;
     bool paused;
-    bool endCut;
-    float totTime;
+    bool endRendered = false;
+    bool benchmarkFrame = false;
+    double timingsTime = 0.0;
 };
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
-Controller::Controller()
-    : impl(std::make_shared<Impl>(this))
-{}
+Controller::Controller(const Arguments& args)
+    : impl(std::make_shared<Impl>(this, args))
+{
+    if (!args.traceOutput.empty())
+    {
+        profiler::setEnabled(true);
+        profiler::setThreadName("main");
+    }
+}
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
@@ -139,10 +208,14 @@ void Controller::run()
         return;
     impl->createScene();
     impl->createWindow();
-    impl->createCameraOrbit();
-    impl->createSatelliteOrbit();
-    impl->cameraOrbit->setTarget(impl->scene->satellite);
+    impl->createSimulation();
     impl->window->run();
+    impl->simulation->stop();
+
+    if (impl->benchmark)
+        impl->benchmark->write(impl->args.benchmarkOutput);
+    if (!impl->args.traceOutput.empty())
+        profiler::write(impl->args.traceOutput);
 }
 
 /* ---------------------------------------------------------------- *
@@ -152,6 +225,8 @@ void Controller::initialize(const glm::ivec2& size,
 {
     impl->scene->camera->aspectRatio = size.x / float(size.y);
     impl->createRenderer(size);
+    if (impl->args.benchmark)
+        impl->benchmark = std::make_shared<Benchmark>();
 }
 
 /* ---------------------------------------------------------------- *
@@ -163,46 +238,60 @@ void Controller::resize(const glm::ivec2& size)
  * ---------------------------------------------------------------- */
 void Controller::update(double elapsed)
 {
-    if (impl->resourceLoad)
-        return;
+    SUNNE_PROFILE_ZONE("Controller::update");
 
-    impl->totTime += float(elapsed);
-
-    // Wait for a while before strating the initial cut.
-    if (impl->totTime < 5000.0f)
+    impl->benchmarkFrame = false;
+    if (impl->resourceLoad)
         return;
 
-    if (impl->paused)
-        return;
+    if (impl->benchmark)
+    {
+        // Step the timeline with a fixed timestep so that each run
+        // renders the exactly same frames. The wall time elapsed still
+        // paces the GPU timings below.
+        impl->benchmark->beginFrame();
+        impl->benchmarkFrame = true;
+        impl->simulation->step(float(Benchmark::TimeStep));
+    }
+    else
+    {
+        // The timeline starts when the resources have been loaded.
+        impl->simulation->start();
+    }
 
-    // Show end cut
-    if (impl->totTime >= 64000.0f)
+    if (impl->args.gpuTimings)
     {
-        if (!impl->endCut)
+        impl->timingsTime += elapsed;
+        if (impl->timingsTime >= 1000.0)
         {
-            impl->scene->planets[0]->rotate = true;
-            impl->scene->planets[0]->rotateAxis = glm::vec3(0, 1, 0);
-            impl->scene->camera->position = glm::vec3(100.000000, 48.000000, 11000.000000);
-            impl->scene->camera->rotation = glm::quat();
-            impl->scene->camera->lens.focalLength = 14.0f;
-            impl->endCut = true;
+            impl->printPassTimings();
+            impl->timingsTime = 0.0;
         }
-        return;
     }
 
-    impl->cameraOrbit->update(float(elapsed));
-    impl->satelliteOrbit->update(float(elapsed));
+    // Nobody can close the headless application and the benchmark
+    // is over, stop after the end cut has been rendered.
+    if (impl->endRendered && (impl->args.headless || impl->benchmark))
+        impl->closeApp = true;
 }
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 void Controller::render()
-{ impl->render(); }
+{
+    SUNNE_PROFILE_ZONE("Controller::render");
+    impl->render();
+}
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 bool Controller::closeApplication()
-{ return impl->closeApp; }
+{
+    // Collect the remaining GPU timings while the context is alive.
+    if (impl->closeApp && impl->benchmark)
+        impl->benchmark->finish();
+    return impl->closeApp;
+}
 
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
@@ -210,9 +299,12 @@ void Controller::setUserInput(const WindowUserInput& i)
 {
     if (i.key.key == GLFW_KEY_ESCAPE)
         impl->closeApp = true;
-    if (i.key.key == GLFW_KEY_SPACE)
+    if (i.key.key == GLFW_KEY_SPACE && !impl->benchmark)
         if (i.key.status == GLFW_PRESS)
+        {
             impl->paused = !impl->paused;
+            impl->simulation->setPaused(impl->paused);
+        }
 }
 
 /* ---------------------------------------------------------------- *
@@ -239,5 +331,20 @@ void Controller::runAsync()
     impl->resourceLoad = false;
 }
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool Controller::idle()
+{ return impl->isIdle(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Controller::setShown(bool shown)
+{
+    // Stop the timeline while the window is hidden, update restarts
+    // it when the window is shown again.
+    if (!shown)
+        impl->simulation->stop();
+}
+
 } // namespace sunne
 } // namespace kuu
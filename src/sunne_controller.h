@@ -13,12 +13,16 @@ namespace kuu
 namespace sunne
 {
 
+/* ---------------------------------------------------------------- */
+
+struct Arguments;
+
 /* ---------------------------------------------------------------- *
  * ---------------------------------------------------------------- */
 class Controller : public WindowCallback
 {
 public:
-    Controller();
+    Controller(const Arguments& args);
     void run();
 
     // WindowCallback overrides
@@ -30,6 +34,8 @@ public:
     void setUserInput(const WindowUserInput& i) override;
     bool startAsync() override;
     void runAsync() override;
+    bool idle() override;
+    void setShown(bool shown) override;
 
 private:
     struct Impl;
@@ -0,0 +1,100 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::file_cache namespace.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_file_cache.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "sunne_hash.h"
+
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+    #include <sys/types.h>
+#endif
+
+namespace kuu
+{
+namespace sunne
+{
+namespace file_cache
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Root directory of the cache, relative to working directory.
+ * ---------------------------------------------------------------- */
+const std::string root = "cache";
+
+/* ---------------------------------------------------------------- *
+   Creates the directory, existing directory is not an error.
+ * ---------------------------------------------------------------- */
+void createDirectory(const std::string& dir)
+{
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::string path(const std::string& category,
+                 uint64_t key,
+                 const std::string& extension)
+{
+    const std::string dir = root + "/" + category;
+    createDirectory(root);
+    createDirectory(dir);
+    return dir + "/" + hash::toString(key) + extension;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool write(const std::string& path, std::initializer_list<Chunk> chunks)
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << __FUNCTION__ << ": failed to open "
+                      << tmpPath << std::endl;
+            return false;
+        }
+
+        for (const Chunk& chunk : chunks)
+            file.write(static_cast<const char*>(chunk.data),
+                       std::streamsize(chunk.size));
+
+        if (!file.good())
+        {
+            std::cerr << __FUNCTION__ << ": failed to write "
+                      << tmpPath << std::endl;
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << __FUNCTION__ << ": failed to rename "
+                  << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace file_cache
+} // namespace sunne
+} // namespace kuu
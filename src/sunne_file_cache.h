@@ -0,0 +1,48 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::file_cache namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace file_cache
+{
+
+/* ---------------------------------------------------------------- *
+   A block of data to write.
+ * ---------------------------------------------------------------- */
+struct Chunk
+{
+    const void* data;
+    size_t size;
+};
+
+/* ---------------------------------------------------------------- *
+   Returns the path of the cache file with the key in the category,
+   e.g. cache/textures/0123456789abcdef.tex. The directory of the
+   category is created if it does not exist.
+ * ---------------------------------------------------------------- */
+std::string path(const std::string& category,
+                 uint64_t key,
+                 const std::string& extension);
+
+/* ---------------------------------------------------------------- *
+   Writes the chunks into the cache file. The data is first written
+   into a temporary file that is then renamed so that a partially
+   written file is never read. Returns false if the write fails,
+   the cache is only an optimization so the caller can continue.
+ * ---------------------------------------------------------------- */
+bool write(const std::string& path, std::initializer_list<Chunk> chunks);
+
+} // namespace file_cache
+} // namespace sunne
+} // namespace kuu
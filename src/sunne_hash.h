@@ -0,0 +1,59 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::hash namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace hash
+{
+
+/* ---------------------------------------------------------------- *
+   Initial value of the hash.
+ * ---------------------------------------------------------------- */
+const uint64_t Seed = 14695981039346656037ull;
+
+/* ---------------------------------------------------------------- *
+   64-bit FNV-1a hash of the data. Pass the previous hash as the
+   seed to combine several values into one hash.
+ * ---------------------------------------------------------------- */
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = Seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+inline uint64_t fnv1a(const std::string& str, uint64_t seed = Seed)
+{ return fnv1a(str.data(), str.size(), seed); }
+
+/* ---------------------------------------------------------------- *
+   Returns the hash as a 16 character hexadecimal string.
+ * ---------------------------------------------------------------- */
+inline std::string toString(uint64_t h)
+{
+    const char* digits = "0123456789abcdef";
+    std::string str(16, '0');
+    for (int i = 15; i >= 0; --i, h >>= 4)
+        str[size_t(i)] = digits[h & 0xf];
+    return str;
+}
+
+} // namespace hash
+} // namespace sunne
+} // namespace kuu
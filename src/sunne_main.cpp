@@ -4,6 +4,7 @@
  * ---------------------------------------------------------------- */
  
 #include <iostream>
+#include "sunne_arguments.h"
 #include "sunne_controller.h"
 
 /* ---------------------------------------------------------------- *
@@ -15,7 +16,8 @@ int main(int argc, char* argv[])
     {
         using namespace kuu;
         using namespace kuu::sunne;
-        Controller controller;
+        Arguments args(argc, argv);
+        Controller controller(args);
         controller.run();
     }
     catch(const std::runtime_error& error)
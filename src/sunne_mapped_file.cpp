@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::MappedFile class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_mapped_file.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct MappedFile::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                           nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY,
+                                     0, 0, nullptr);
+        if (!mapping)
+            return;
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+            return;
+
+        data = static_cast<const unsigned char*>(view);
+        size = size_t(fileSize.QuadPart);
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+            return;
+
+        void* view = mmap(nullptr, size_t(st.st_size), PROT_READ,
+                          MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+            return;
+
+        data = static_cast<const unsigned char*>(view);
+        size = size_t(st.st_size);
+#endif
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap(const_cast<unsigned char*>(data), size);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+#ifdef _WIN32
+    HANDLE file    = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+MappedFile::MappedFile(const std::string& path)
+    : impl(std::make_shared<Impl>(path))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool MappedFile::isOpen() const
+{ return impl->data != nullptr; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const unsigned char* MappedFile::data() const
+{ return impl->data; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+size_t MappedFile::size() const
+{ return impl->size; }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,38 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::MappedFile class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   A read-only memory mapping of a file. The mapping is released
+   when the last copy of the object is destroyed.
+ * ---------------------------------------------------------------- */
+class MappedFile
+{
+public:
+    // Maps the file. If the file can not be mapped then the
+    // object is not open.
+    MappedFile(const std::string& path);
+
+    bool isOpen() const;
+    const unsigned char* data() const;
+    size_t size() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
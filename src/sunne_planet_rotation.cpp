@@ -0,0 +1,70 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::PlanetRotation class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_planet_rotation.h"
+#include <glm/trigonometric.hpp>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct PlanetRotation::Impl
+{
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(PlanetRotation* self, std::shared_ptr<RendererScene::Planet> planet)
+        : self(self)
+        , planet(planet)
+    {}
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void update(float elapsed)
+    {
+        // Amounts are per 60 Hz frame.
+        const float frames = elapsed / (1000.0f / 60.0f);
+
+        // Slow rotation
+        float amount = 0.0005f;
+        glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+        if (planet->rotate)
+        {
+            // Fast rotation
+            amount = 0.05f;
+            axis = planet->rotateAxis;
+        }
+        planet->rotation *= glm::angleAxis(glm::radians(amount * frames), axis);
+
+        // Update texture coordinate offset of clouds
+        glm::vec2& texOffset = planet->cloudMapOffset;
+        texOffset.x -= 0.00001f * frames;
+        if (texOffset.x > 1.0f)
+            texOffset.x = 1.0f - texOffset.x;
+        if (texOffset.x < 0.0f)
+            texOffset.x = 1.0f + texOffset.x;
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    PlanetRotation* self;
+    std::shared_ptr<RendererScene::Planet> planet;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+PlanetRotation::PlanetRotation(std::shared_ptr<RendererScene::Planet> planet)
+    : impl(std::make_shared<Impl>(this, planet))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void PlanetRotation::update(float elapsed)
+{ impl->update(elapsed); }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,32 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::PlanetRotation class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include "renderer/sunne_renderer_scene.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Spins the planet around its axis and moves the clouds.
+ * ---------------------------------------------------------------- */
+class PlanetRotation
+{
+public:
+    PlanetRotation(std::shared_ptr<RendererScene::Planet> planet);
+
+    void update(float elapsed);
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
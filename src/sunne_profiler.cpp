@@ -0,0 +1,200 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::profiler namespace.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace profiler
+{
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Count of zones per thread.
+ * ---------------------------------------------------------------- */
+const size_t RingSize = 1 << 16;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Event
+{
+    const char* name;
+    int64_t start;    // ns
+    int64_t duration; // ns
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct ThreadBuffer
+{
+    int id = 0;
+    std::string name;
+    std::vector<Event> events = std::vector<Event>(RingSize);
+    size_t count = 0; // total count of recorded events
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+std::atomic<bool> enabled(false);
+std::mutex buffersMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+/* ---------------------------------------------------------------- *
+   Returns the buffer of the calling thread. The buffer is registered
+   on the first call.
+ * ---------------------------------------------------------------- */
+ThreadBuffer& threadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        auto b = std::make_shared<ThreadBuffer>();
+        b->id = int(buffers.size()) + 1;
+        b->name = "thread " + std::to_string(b->id);
+        buffers.push_back(b);
+        buffer = b.get();
+    }
+    return *buffer;
+}
+
+/* ---------------------------------------------------------------- *
+   Returns nanoseconds since the profiler start.
+ * ---------------------------------------------------------------- */
+int64_t now()
+{
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point epoch = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - epoch).count();
+}
+
+/* ---------------------------------------------------------------- *
+   Writes the string as a JSON string.
+ * ---------------------------------------------------------------- */
+void writeString(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void setEnabled(bool e)
+{
+    now(); // start the clock
+    enabled.store(e, std::memory_order_relaxed);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool isEnabled()
+{ return enabled.load(std::memory_order_relaxed); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void setThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer.name = name;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void write(const std::string& filePath)
+{
+    std::ofstream out(filePath);
+    if (!out.is_open())
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": failed to open " + filePath);
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    bool first = true;
+    auto separator = [&]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    // Microseconds with the nanoseconds as the fraction.
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\": [";
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        separator();
+        out << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, "
+            << "\"tid\": " << buffer->id << ", \"args\": {\"name\": ";
+        writeString(out, buffer->name);
+        out << "}}";
+
+        const size_t count = std::min(buffer->count, RingSize);
+        const size_t begin = buffer->count - count;
+        for (size_t i = begin; i < buffer->count; ++i)
+        {
+            const Event& e = buffer->events[i % RingSize];
+            separator();
+            out << "{\"ph\": \"X\", \"name\": ";
+            writeString(out, e.name);
+            out << ", \"pid\": 1, \"tid\": " << buffer->id
+                << ", \"ts\": "  << double(e.start)    / 1000.0
+                << ", \"dur\": " << double(e.duration) / 1000.0
+                << "}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Zone::Zone(const char* name)
+    : name_(nullptr)
+    , start_(0)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+        return;
+
+    name_  = name;
+    start_ = now();
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Zone::~Zone()
+{
+    if (!name_)
+        return;
+
+    const int64_t end = now();
+    ThreadBuffer& buffer = threadBuffer();
+    buffer.events[buffer.count % RingSize] = { name_, start_, end - start_ };
+    buffer.count++;
+}
+
+} // namespace profiler
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,67 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::profiler namespace.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace kuu
+{
+namespace sunne
+{
+namespace profiler
+{
+
+/* ---------------------------------------------------------------- *
+   Enables or disables the zone recording. Disabled by default, then
+   a zone costs a single atomic load.
+ * ---------------------------------------------------------------- */
+void setEnabled(bool enabled);
+bool isEnabled();
+
+/* ---------------------------------------------------------------- *
+   Sets the name of the calling thread for the trace.
+ * ---------------------------------------------------------------- */
+void setThreadName(const std::string& name);
+
+/* ---------------------------------------------------------------- *
+   Writes the recorded zones of all threads into a Chrome trace
+   event JSON file (chrome://tracing, Perfetto). Must be called when
+   the other threads are not recording anymore.
+ * ---------------------------------------------------------------- */
+void write(const std::string& filePath);
+
+/* ---------------------------------------------------------------- *
+   Records the lifetime of the object as a zone. Name must outlive
+   the profiler, e.g. be a string literal. Each thread records into
+   its own ring buffer, the oldest zones are overwritten when the
+   buffer is full.
+ * ---------------------------------------------------------------- */
+class Zone
+{
+public:
+    Zone(const char* name);
+    ~Zone();
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_;
+};
+
+} // namespace profiler
+} // namespace sunne
+} // namespace kuu
+
+/* ---------------------------------------------------------------- *
+   Records a zone until the end of the current scope.
+ * ---------------------------------------------------------------- */
+#define SUNNE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SUNNE_PROFILE_CONCAT(a, b) SUNNE_PROFILE_CONCAT_IMPL(a, b)
+#define SUNNE_PROFILE_ZONE(name) \
+    ::kuu::sunne::profiler::Zone SUNNE_PROFILE_CONCAT(profileZone, __LINE__)(name)
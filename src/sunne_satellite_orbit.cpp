@@ -32,7 +32,8 @@ struct SatelliteOrbit::Impl
     {
         totTime += elapsed;
 
-        const float step = 0.16f; // note: v-sync is enabled
+        // Step is per 60 Hz frame.
+        const float step = 0.16f * elapsed / (1000.0f / 60.0f);
         glm::quat rot = glm::angleAxis(glm::radians(step), glm::vec3(-1.0f, 0.0f, 0.0f));
         satellite->rotation *= rot;
 
@@ -0,0 +1,226 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::Simulation class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_simulation.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "sunne_camera_orbit.h"
+#include "sunne_planet_rotation.h"
+#include "sunne_profiler.h"
+#include "sunne_satellite_orbit.h"
+#include "sunne_triple_buffer.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Simulation::Snapshot::apply(RendererScene& scene) const
+{
+    const float aspectRatio = scene.camera->aspectRatio;
+    *scene.camera = camera;
+    scene.camera->aspectRatio = aspectRatio;
+
+    *scene.satellite = satellite;
+
+    RendererScene::Planet& planet = *scene.planets[0];
+    planet.rotation       = planetRotation;
+    planet.cloudMapOffset = planetCloudMapOffset;
+    planet.rotate         = planetRotate;
+    planet.rotateAxis     = planetRotateAxis;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct Simulation::Impl
+{
+    using Clock = std::chrono::steady_clock;
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    Impl(const RendererScene& scene)
+        : camera(std::make_shared<RendererScene::Camera>(*scene.camera))
+        , satellite(std::make_shared<RendererScene::Satellite>(*scene.satellite))
+        , planet(std::make_shared<RendererScene::Planet>(*scene.planets[0]))
+        , cameraOrbit(camera)
+        , satelliteOrbit(satellite)
+        , planetRotation(planet)
+    {
+        cameraOrbit.setTarget(satellite);
+        publish();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    ~Impl()
+    {
+        stop();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void start()
+    {
+        if (thread.joinable())
+            return;
+        running = true;
+        thread = std::thread([this]() { run(); });
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        running = false;
+        thread.join();
+    }
+
+    /* ------------------------------------------------------------ *
+       Steps at the step rate. A step that is late is not caught
+       up, the timeline slows down instead.
+     * ------------------------------------------------------------ */
+    void run()
+    {
+        if (profiler::isEnabled())
+            profiler::setThreadName("simulation");
+
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / StepRate));
+        const float elapsed = float(1000.0 / StepRate);
+
+        Clock::time_point next = Clock::now();
+        while (running)
+        {
+            step(elapsed);
+
+            next += period;
+            const Clock::time_point now = Clock::now();
+            if (next < now)
+                next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void step(float elapsed)
+    {
+        SUNNE_PROFILE_ZONE("Simulation::step");
+
+        totTime += elapsed;
+
+        // The objects do not move, there is nothing to publish.
+        if (paused)
+            return;
+
+        planetRotation.update(elapsed);
+
+        // Wait for a while before strating the initial cut.
+        if (totTime >= 5000.0f)
+        {
+            if (totTime >= 64000.0f)
+            {
+                // Show end cut
+                if (!ended)
+                {
+                    planet->rotate = true;
+                    planet->rotateAxis = glm::vec3(0, 1, 0);
+                    camera->position = glm::vec3(100.000000, 48.000000, 11000.000000);
+                    camera->rotation = glm::quat();
+                    camera->lens.focalLength = 14.0f;
+                    camera->cuts++;
+                    ended = true;
+                }
+            }
+            else
+            {
+                cameraOrbit.update(elapsed);
+                satelliteOrbit.update(elapsed);
+            }
+        }
+
+        publish();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    void publish()
+    {
+        Snapshot& s = snapshots.back();
+        s.camera               = *camera;
+        s.satellite            = *satellite;
+        s.planetRotation       = planet->rotation;
+        s.planetCloudMapOffset = planet->cloudMapOffset;
+        s.planetRotate         = planet->rotate;
+        s.planetRotateAxis     = planet->rotateAxis;
+        s.ended                = ended;
+        snapshots.publish();
+    }
+
+    /* ------------------------------------------------------------ *
+     * ------------------------------------------------------------ */
+    // Owned by the stepping thread.
+    std::shared_ptr<RendererScene::Camera> camera;
+    std::shared_ptr<RendererScene::Satellite> satellite;
+    std::shared_ptr<RendererScene::Planet> planet;
+    CameraOrbit cameraOrbit;
+    SatelliteOrbit satelliteOrbit;
+    PlanetRotation planetRotation;
+    float totTime = 0.0f;
+    bool ended = false;
+
+    std::atomic<bool> paused { false };
+    std::atomic<bool> running { false };
+    std::thread thread;
+    TripleBuffer<Snapshot> snapshots;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+constexpr double Simulation::StepRate;
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+Simulation::Simulation(const RendererScene& scene)
+    : impl(std::make_shared<Impl>(scene))
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Simulation::start()
+{ impl->start(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Simulation::stop()
+{ impl->stop(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Simulation::step(float elapsed)
+{ impl->step(elapsed); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void Simulation::setPaused(bool paused)
+{ impl->paused = paused; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool Simulation::update()
+{ return impl->snapshots.update(); }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+const Simulation::Snapshot& Simulation::snapshot() const
+{ return impl->snapshots.front(); }
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,80 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::Simulation class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <memory>
+#include "renderer/sunne_renderer_scene.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Runs the timeline of the scene: the planet rotation, the camera
+   and satellite orbits and the cuts. The simulation has its own
+   copies of the moving scene objects and publishes a snapshot of
+   them after each step, the render thread applies the latest
+   complete snapshot into its scene before the frame is rendered.
+
+   The simulation is either stepped by the caller, e.g. with the
+   fixed timestep of the benchmark, or by its own thread at
+   StepRate. The snapshots are passed through a lock-free triple
+   buffer, neither thread waits for the other.
+ * ---------------------------------------------------------------- */
+class Simulation
+{
+public:
+    /* ------------------------------------------------------------ *
+       State of the moving scene objects after a step.
+     * ------------------------------------------------------------ */
+    struct Snapshot
+    {
+        RendererScene::Camera camera;
+        RendererScene::Satellite satellite;
+        glm::quat planetRotation;
+        glm::vec2 planetCloudMapOffset;
+        bool planetRotate = false;
+        glm::vec3 planetRotateAxis;
+        // True when the end cut is shown.
+        bool ended = false;
+
+        // Copies the state into the scene. The aspect ratio of the
+        // scene camera is kept, it follows the window.
+        void apply(RendererScene& scene) const;
+    };
+
+    // Steps per second of the simulation thread.
+    static constexpr double StepRate = 120.0;
+
+    // Copies the moving objects of the scene.
+    Simulation(const RendererScene& scene);
+
+    // Starts the simulation thread if it is not running.
+    void start();
+    // Stops and joins the simulation thread. The timeline does not
+    // advance until the thread is started again.
+    void stop();
+
+    // Advances the simulation and publishes a snapshot. Must not be
+    // called while the thread is running. Elapsed is milliseconds.
+    void step(float elapsed);
+
+    // A paused simulation runs the clock, the objects stay still.
+    void setPaused(bool paused);
+
+    // The render thread side. Takes the latest published snapshot,
+    // returns false if it is the same as on the previous call.
+    bool update();
+    const Snapshot& snapshot() const;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,67 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::TripleBuffer class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+#include <atomic>
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- *
+   Passes values from one writer thread to one reader thread
+   without locks. The writer fills the back value and publishes it,
+   the reader takes the latest published value as its front value.
+   Neither side waits for the other, the values that the reader does
+   not take in time are overwritten.
+
+   The three values are swapped by their indices. The middle index
+   is shared with an atomic exchange and flagged when it holds a
+   value that the reader has not taken.
+ * ---------------------------------------------------------------- */
+template<typename T>
+class TripleBuffer
+{
+public:
+    // The writer side. Returns the value to fill.
+    T& back()
+    { return values[backIndex]; }
+
+    // The writer side. Makes the back value the latest value.
+    void publish()
+    {
+        backIndex = middle.exchange(backIndex | Fresh,
+                                    std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // The reader side. Takes the latest value if a value has been
+    // published since the previous call. Returns true if the front
+    // value changed.
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & Fresh))
+            return false;
+        frontIndex = middle.exchange(frontIndex,
+                                     std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+
+    // The reader side. Returns the latest value taken with update.
+    const T& front() const
+    { return values[frontIndex]; }
+
+private:
+    enum : unsigned { IndexMask = 3, Fresh = 4 };
+
+    T values[3];
+    unsigned backIndex  = 0;
+    unsigned frontIndex = 2;
+    std::atomic<unsigned> middle { 1 };
+};
+
+} // namespace sunne
+} // namespace kuu
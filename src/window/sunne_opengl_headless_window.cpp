@@ -0,0 +1,335 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Implementation of kuu::sunne::OpenGLHeadlessWindow class.
+ * ---------------------------------------------------------------- */
+
+#include "sunne_opengl_headless_window.h"
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <glad/glad.h>
+
+#ifdef SUNNE_EGL
+    #define EGL_NO_X11
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+#include "sunne_window_callback.h"
+#include "sunne_window_parameters.h"
+#include "../renderer/opengl/sunne_opengl_shader_loader.h"
+#include "../sunne_profiler.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+#ifdef SUNNE_EGL
+
+namespace
+{
+
+/* ---------------------------------------------------------------- *
+   Returns true if the space separated extension string contains
+   the given extension.
+ * ---------------------------------------------------------------- */
+bool hasExtension(const char* extensions, const std::string& extension)
+{
+    if (!extensions)
+        return false;
+
+    const std::string all = std::string(" ") + extensions + " ";
+    return all.find(" " + extension + " ") != std::string::npos;
+}
+
+/* ---------------------------------------------------------------- *
+   Returns the EGL display. Mesa surfaceless platform is preferred
+   as it does not need any window system or a render node.
+ * ---------------------------------------------------------------- */
+EGLDisplay getDisplay()
+{
+    const char* clientExtensions =
+        eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless") &&
+        hasExtension(clientExtensions, "EGL_EXT_platform_base"))
+    {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay)
+        {
+            EGLDisplay display = getPlatformDisplay(
+                EGL_PLATFORM_SURFACELESS_MESA,
+                EGL_DEFAULT_DISPLAY,
+                nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+/* ---------------------------------------------------------------- *
+   Run a callback job asynchronously.
+ * ---------------------------------------------------------------- */
+void runAsyncJob(EGLDisplay display,
+                 EGLSurface surface,
+                 EGLContext context,
+                 WindowCallback* callback)
+{
+    if (profiler::isEnabled())
+        profiler::setThreadName("loader");
+    SUNNE_PROFILE_ZONE("runAsyncJob");
+
+    eglMakeCurrent(display, surface, surface, context);
+    callback->runAsync();
+    glFinish();
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+} // anonymous namespace
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLHeadlessWindow::Data
+{
+    // EGL objects of the rendering context.
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLSurface surface = EGL_NO_SURFACE;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    // EGL objects of the asynchronous context.
+    EGLSurface surfaceThreading = EGL_NO_SURFACE;
+    EGLContext contextThreading = EGL_NO_CONTEXT;
+
+    // Async job
+    std::future<void> asyncJob;
+
+    // Size of the pbuffer.
+    glm::ivec2 size;
+
+    // Window title.
+    std::string windowTitle;
+};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLHeadlessWindow::OpenGLHeadlessWindow(const WindowParams& params)
+    : Window(params)
+    , d(std::make_shared<Data>())
+{
+    d->windowTitle = params.title;
+    d->size        = params.size;
+
+    // Mesa selects llvmpipe when hardware drivers are disallowed.
+    if (params.opengl.software)
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+
+    d->display = getDisplay();
+    if (d->display == EGL_NO_DISPLAY)
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": failed to get EGL display");
+
+    EGLint major, minor;
+    if (!eglInitialize(d->display, &major, &minor))
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": failed to initialize EGL");
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": EGL does not support desktop OpenGL");
+
+    const EGLint configAttribs[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,        8,
+        EGL_GREEN_SIZE,      8,
+        EGL_BLUE_SIZE,       8,
+        EGL_ALPHA_SIZE,      8,
+        EGL_DEPTH_SIZE,      24,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(d->display, configAttribs, &config, 1, &configCount) ||
+        configCount == 0)
+    {
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": failed to find EGL pbuffer config");
+    }
+
+    const EGLint surfaceAttribs[] =
+    {
+        EGL_WIDTH,  params.size.x,
+        EGL_HEIGHT, params.size.y,
+        EGL_NONE
+    };
+
+    const EGLint surfaceThreadingAttribs[] =
+    {
+        EGL_WIDTH,  1,
+        EGL_HEIGHT, 1,
+        EGL_NONE
+    };
+
+    const EGLint contextAttribs[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION,       params.opengl.major,
+        EGL_CONTEXT_MINOR_VERSION,       params.opengl.minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    d->surface = eglCreatePbufferSurface(d->display, config, surfaceAttribs);
+    d->context = eglCreateContext(d->display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (d->surface == EGL_NO_SURFACE || d->context == EGL_NO_CONTEXT)
+    {
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+                ": failed to create EGL context");
+    }
+
+    d->surfaceThreading = eglCreatePbufferSurface(d->display, config, surfaceThreadingAttribs);
+    d->contextThreading = eglCreateContext(d->display, config, d->context, contextAttribs);
+
+    callback_ = params.callback;
+
+    eglMakeCurrent(d->display, d->surface, d->surface, d->context);
+    eglSwapInterval(d->display, 0);
+
+    if (gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)) == 0)
+        throw std::runtime_error(
+            std::string(__FUNCTION__) +
+            ": failed to load OpenGL");
+    opengl_shader_loader::loadExtensions(
+        reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+
+    std::cout << __FUNCTION__ << ": "
+              << "EGL " << major << "." << minor << ", "
+              << glGetString(GL_RENDERER)
+              << std::endl;
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLHeadlessWindow::~OpenGLHeadlessWindow()
+{
+    if (d->asyncJob.valid())
+        d->asyncJob.wait();
+
+    eglMakeCurrent(d->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (d->contextThreading != EGL_NO_CONTEXT)
+        eglDestroyContext(d->display, d->contextThreading);
+    if (d->surfaceThreading != EGL_NO_SURFACE)
+        eglDestroySurface(d->display, d->surfaceThreading);
+    eglDestroyContext(d->display, d->context);
+    eglDestroySurface(d->display, d->surface);
+    eglTerminate(d->display);
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLHeadlessWindow::run()
+{
+    if (!callback_)
+        return;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+    double prevTime = 0.0;
+
+    // Initialize
+    callback_->initialize(d->size, nullptr);
+
+    // Start loop.
+    int frameCounter = 0;
+    double elapsedCounter = 0.0;
+    while (!callback_->closeApplication())
+    {
+        if (callback_->startAsync())
+        {
+            if (!d->asyncJob.valid())
+                d->asyncJob = std::async(
+                    std::launch::async,
+                    runAsyncJob,
+                    d->display,
+                    d->surfaceThreading,
+                    d->contextThreading,
+                    callback_);
+        }
+
+        if (d->asyncJob.valid() &&
+            d->asyncJob.wait_for(std::chrono::milliseconds(1))
+                == std::future_status::ready)
+        {
+            d->asyncJob.get();
+        }
+
+        const double time = std::chrono::duration<double>(
+            Clock::now() - startTime).count();
+        const double elapsed = time - prevTime;
+        prevTime = time;
+        callback_->update(elapsed * 1000.0);
+        callback_->render();
+
+        frameCounter++;
+        elapsedCounter += (elapsed * 1000.0);
+        if (elapsedCounter >= 1000.0)
+        {
+            std::cout << d->windowTitle << " - "
+                      << frameCounter   << " FPS"
+                      << std::endl;
+            frameCounter = 0;
+            elapsedCounter = 0.0;
+        }
+
+        eglSwapBuffers(d->display, d->surface);
+    }
+
+    if (d->asyncJob.valid())
+        d->asyncJob.wait();
+}
+
+#else // SUNNE_EGL
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+struct OpenGLHeadlessWindow::Data
+{};
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLHeadlessWindow::OpenGLHeadlessWindow(const WindowParams& params)
+    : Window(params)
+{
+    throw std::runtime_error(
+        std::string(__FUNCTION__) +
+        ": headless rendering requires EGL");
+}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+OpenGLHeadlessWindow::~OpenGLHeadlessWindow()
+{}
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void OpenGLHeadlessWindow::run()
+{}
+
+#endif // SUNNE_EGL
+
+} // namespace sunne
+} // namespace kuu
@@ -0,0 +1,53 @@
+/* ---------------------------------------------------------------- *
+   Antti Jumpponen <kuumies@gmail.com>
+   Definition of kuu::sunne::OpenGLHeadlessWindow class.
+ * ---------------------------------------------------------------- */
+
+#pragma once
+
+/* ---------------------------------------------------------------- */
+
+#include <memory>
+#include "sunne_window.h"
+
+namespace kuu
+{
+namespace sunne
+{
+
+/* ---------------------------------------------------------------- */
+
+struct WindowParams;
+
+/* ---------------------------------------------------------------- *
+   An offscreen OpenGL 3.3 core context for machines without a
+   display server. The context is created with EGL on top of a
+   pbuffer surface of the window size, on Mesa this runs fine on
+   the llvmpipe software rasterizer.
+
+   Like the OpenGLWindow, asynchronous calls are run with a shared
+   context. User input is never received.
+
+   Requires that the application is built with EGL (SUNNE_EGL),
+   otherwise the construction fails.
+ * ---------------------------------------------------------------- */
+class OpenGLHeadlessWindow : public Window
+{
+public:
+    // Constructs the context. This will throw std::runtime_error
+    // if the context creation fails.
+    OpenGLHeadlessWindow(const WindowParams& params);
+    // Destroys the context.
+    ~OpenGLHeadlessWindow();
+
+    // Starts the process loop for rendering that runs until the
+    // callback requests to close the application.
+    void run();
+
+private:
+    struct Data;
+    std::shared_ptr<Data> d;
+};
+
+} // namespace sunne
+} // namespace kuu
@@ -14,6 +14,8 @@
 #include "sunne_window_mediator.h"
 #include "sunne_window_parameters.h"
 #include "sunne_window_user_input.h"
+#include "../renderer/opengl/sunne_opengl_shader_loader.h"
+#include "../sunne_profiler.h"
 
 #include <stb_image.h>
 
@@ -24,11 +26,19 @@ namespace sunne
 namespace
 {
 
+// Maximum wait for the events in seconds when the callback is idle
+// or the window is not shown.
+const double IdleWaitTimeout = 0.1;
+
 /* ---------------------------------------------------------------- *
    Run a callback job asynchronously.
  * ---------------------------------------------------------------- */
 void runAsyncJob(GLFWwindow* window, WindowCallback* callback)
 {
+    if (profiler::isEnabled())
+        profiler::setThreadName("loader");
+    SUNNE_PROFILE_ZONE("runAsyncJob");
+
     glfwMakeContextCurrent(window);
     callback->runAsync();
     //glFlush(); // Needs to be called, otherwise no textures
@@ -152,6 +162,8 @@ OpenGLWindow::OpenGLWindow(const WindowParams& params)
         throw std::runtime_error(
             std::string(__FUNCTION__) +
             ": failed to load OpenGL");
+    opengl_shader_loader::loadExtensions(
+        reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 }
 
 /* ---------------------------------------------------------------- *
@@ -179,6 +191,7 @@ void OpenGLWindow::run()
     // Start loop.
     int frameCounter = 0;
     double elapsedCounter = 0.0;
+    bool shown = true;
     while (!glfwWindowShouldClose(window_))
     {
         if (callback_)
@@ -204,6 +217,23 @@ void OpenGLWindow::run()
                 glfwMakeContextCurrent(window_);
             }
 
+            // Nothing is shown, the callback stops the timeline and it
+            // continues from where it was when the window is restored.
+            const bool hidden =
+                glfwGetWindowAttrib(window_, GLFW_ICONIFIED) ||
+                !glfwGetWindowAttrib(window_, GLFW_VISIBLE);
+            if (hidden != !shown)
+            {
+                shown = !hidden;
+                callback_->setShown(shown);
+            }
+            if (hidden)
+            {
+                glfwWaitEventsTimeout(IdleWaitTimeout);
+                d->prevTime = glfwGetTime();
+                continue;
+            }
+
             const double time = glfwGetTime();
             const double elapsed = time - d->prevTime;
             d->prevTime = time;
@@ -227,7 +257,12 @@ void OpenGLWindow::run()
         }
 
         glfwSwapBuffers(window_);
-        glfwPollEvents();
+
+        // An user action wakes the loop up at once.
+        if (callback_ && callback_->idle())
+            glfwWaitEventsTimeout(IdleWaitTimeout);
+        else
+            glfwPollEvents();
     }
 
     if (d->asyncJob.valid())
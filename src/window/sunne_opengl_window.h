@@ -34,7 +34,10 @@ public:
     OpenGLWindow(const WindowParams& params);
 
     // Starts the process loop for rendering and polling the user
-    // actions that runs until window is closed.
+    // actions that runs until window is closed. While the callback
+    // is idle the loop waits for the user actions between the
+    // frames. Nothing is updated or rendered while the window is
+    // iconified or hidden.
     void run();
 
 private:
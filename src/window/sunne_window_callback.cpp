@@ -25,5 +25,15 @@ bool WindowCallback::startAsync()
 void WindowCallback::runAsync()
 {}
 
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+bool WindowCallback::idle()
+{ return false; }
+
+/* ---------------------------------------------------------------- *
+ * ---------------------------------------------------------------- */
+void WindowCallback::setShown(bool /*shown*/)
+{}
+
 } // namespace sunne
 } // namespace kuu
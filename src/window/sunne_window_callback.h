@@ -54,6 +54,15 @@ public:
     // A function that is run asynchronously.
     virtual void runAsync();
 
+    // Return true when the content does not change, e.g. when the
+    // animation is paused. The window then waits for the events
+    // between the frames instead of rendering continuously.
+    virtual bool idle();
+
+    // Called when the window is hidden, e.g. iconified, and when it
+    // is shown again. Nothing is rendered while it is hidden.
+    virtual void setShown(bool shown);
+
     // Sets an user input.
     virtual void setUserInput(const WindowUserInput& i) = 0;
 };
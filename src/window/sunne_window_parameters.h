@@ -53,6 +53,10 @@ struct WindowParams
     {
         int major = 3;
         int minor = 3;
+
+        // Forces the software rasterizer. Used only by the
+        // headless window.
+        bool software = false;
     } opengl;
 };
 